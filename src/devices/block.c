@@ -18,6 +18,7 @@ struct block {
 
   unsigned long long read_cnt;  /* Number of sectors read. */
   unsigned long long write_cnt; /* Number of sectors written. */
+  unsigned long long io_cnt;    /* Number of requests issued. */
 };
 
 /* List of all block devices. */
@@ -98,6 +99,7 @@ void block_read(struct block* block, block_sector_t sector, void* buffer) {
   check_sector(block, sector);
   block->ops->read(block->aux, sector, buffer);
   block->read_cnt++;
+  block->io_cnt++;
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -110,6 +112,54 @@ void block_write(struct block* block, block_sector_t sector, const void* buffer)
   ASSERT(block->type != BLOCK_FOREIGN);
   block->ops->write(block->aux, sector, buffer);
   block->write_cnt++;
+  block->io_cnt++;
+}
+
+/* Reads CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Uses a single request if the driver supports it. */
+void block_read_multiple(struct block* block, block_sector_t sector, size_t cnt, void* buffer) {
+  uint8_t* p = buffer;
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector(block, sector);
+  check_sector(block, sector + cnt - 1);
+  if (block->ops->read_multiple != NULL) {
+    block->ops->read_multiple(block->aux, sector, cnt, buffer);
+    block->io_cnt++;
+  } else {
+    for (i = 0; i < cnt; i++)
+      block->ops->read(block->aux, sector + i, p + i * BLOCK_SECTOR_SIZE);
+    block->io_cnt += cnt;
+  }
+  block->read_cnt += cnt;
+}
+
+/* Writes CNT consecutive sectors starting at SECTOR to BLOCK
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Uses a single request if the driver supports it.  Returns
+   after the block device has acknowledged receiving the data. */
+void block_write_multiple(struct block* block, block_sector_t sector, size_t cnt,
+                          const void* buffer) {
+  const uint8_t* p = buffer;
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector(block, sector);
+  check_sector(block, sector + cnt - 1);
+  ASSERT(block->type != BLOCK_FOREIGN);
+  if (block->ops->write_multiple != NULL) {
+    block->ops->write_multiple(block->aux, sector, cnt, buffer);
+    block->io_cnt++;
+  } else {
+    for (i = 0; i < cnt; i++)
+      block->ops->write(block->aux, sector + i, p + i * BLOCK_SECTOR_SIZE);
+    block->io_cnt += cnt;
+  }
+  block->write_cnt += cnt;
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -128,8 +178,8 @@ void block_print_stats(void) {
   for (i = 0; i < BLOCK_ROLE_CNT; i++) {
     struct block* block = block_by_role[i];
     if (block != NULL) {
-      printf("%s (%s): %llu reads, %llu writes\n", block->name, block_type_name(block->type),
-             block->read_cnt, block->write_cnt);
+      printf("%s (%s): %llu reads, %llu writes, %llu requests\n", block->name,
+             block_type_name(block->type), block->read_cnt, block->write_cnt, block->io_cnt);
     }
   }
 }
@@ -153,6 +203,7 @@ struct block* block_register(const char* name, enum block_type type, const char*
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  block->io_cnt = 0;
 
   printf("%s: %'" PRDSNu " sectors (", block->name, block->size);
   print_human_readable_size((uint64_t)block->size * BLOCK_SECTOR_SIZE);
@@ -52,6 +52,8 @@ struct block* block_next(struct block*);
 block_sector_t block_size(struct block*);
 void block_read(struct block*, block_sector_t, void*);
 void block_write(struct block*, block_sector_t, const void*);
+void block_read_multiple(struct block*, block_sector_t, size_t cnt, void*);
+void block_write_multiple(struct block*, block_sector_t, size_t cnt, const void*);
 const char* block_name(struct block*);
 enum block_type block_type(struct block*);
 
@@ -63,6 +65,11 @@ void block_print_stats(void);
 struct block_operations {
   void (*read)(void* aux, block_sector_t, void* buffer);
   void (*write)(void* aux, block_sector_t, const void* buffer);
+
+  /* Optional: transfer CNT consecutive sectors in one request.
+     Null if the driver can only move one sector at a time. */
+  void (*read_multiple)(void* aux, block_sector_t, size_t cnt, void* buffer);
+  void (*write_multiple)(void* aux, block_sector_t, size_t cnt, const void* buffer);
 };
 
 struct block* block_register(const char* name, enum block_type, const char* extra_info,
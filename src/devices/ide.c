@@ -83,7 +83,7 @@ static void reset_channel(struct channel*);
 static bool check_device_type(struct ata_disk*);
 static void identify_ata_device(struct ata_disk*);
 
-static void select_sector(struct ata_disk*, block_sector_t);
+static void select_sector(struct ata_disk*, block_sector_t, size_t cnt);
 static void issue_pio_command(struct channel*, uint8_t command);
 static void input_sector(struct channel*, void*);
 static void output_sector(struct channel*, const void*);
@@ -314,7 +314,7 @@ static void ide_read(void* d_, block_sector_t sec_no, void* buffer) {
   struct ata_disk* d = d_;
   struct channel* c = d->channel;
   lock_acquire(&c->lock);
-  select_sector(d, sec_no);
+  select_sector(d, sec_no, 1);
   issue_pio_command(c, CMD_READ_SECTOR_RETRY);
   sema_down(&c->completion_wait);
   if (!wait_while_busy(d))
@@ -332,7 +332,7 @@ static void ide_write(void* d_, block_sector_t sec_no, const void* buffer) {
   struct ata_disk* d = d_;
   struct channel* c = d->channel;
   lock_acquire(&c->lock);
-  select_sector(d, sec_no);
+  select_sector(d, sec_no, 1);
   issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
   if (!wait_while_busy(d))
     PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
@@ -341,18 +341,86 @@ static void ide_write(void* d_, block_sector_t sec_no, const void* buffer) {
   lock_release(&c->lock);
 }
 
-static struct block_operations ide_operations = {ide_read, ide_write};
+/* Maximum number of sectors one READ or WRITE SECTORS command
+   can transfer.  A count of 0 in the sector count register
+   means 256. */
+#define MAX_SECTORS_PER_CMD 256
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.  Issues
+   one command per MAX_SECTORS_PER_CMD sectors; the disk raises
+   an interrupt as each sector becomes ready.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void ide_read_multiple(void* d_, block_sector_t sec_no, size_t cnt, void* buffer) {
+  struct ata_disk* d = d_;
+  struct channel* c = d->channel;
+  uint8_t* p = buffer;
+
+  lock_acquire(&c->lock);
+  while (cnt > 0) {
+    size_t chunk = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+    size_t i;
+
+    select_sector(d, sec_no, chunk);
+    issue_pio_command(c, CMD_READ_SECTOR_RETRY);
+    for (i = 0; i < chunk; i++) {
+      sema_down(&c->completion_wait);
+      if (!wait_while_busy(d))
+        PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, sec_no + i);
+      input_sector(c, p);
+      p += BLOCK_SECTOR_SIZE;
+    }
+    sec_no += chunk;
+    cnt -= chunk;
+  }
+  lock_release(&c->lock);
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes.  Returns
+   after the disk has acknowledged receiving all of the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void ide_write_multiple(void* d_, block_sector_t sec_no, size_t cnt, const void* buffer) {
+  struct ata_disk* d = d_;
+  struct channel* c = d->channel;
+  const uint8_t* p = buffer;
+
+  lock_acquire(&c->lock);
+  while (cnt > 0) {
+    size_t chunk = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+    size_t i;
+
+    select_sector(d, sec_no, chunk);
+    issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
+    for (i = 0; i < chunk; i++) {
+      if (!wait_while_busy(d))
+        PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no + i);
+      output_sector(c, p);
+      sema_down(&c->completion_wait);
+      p += BLOCK_SECTOR_SIZE;
+    }
+    sec_no += chunk;
+    cnt -= chunk;
+  }
+  lock_release(&c->lock);
+}
+
+static struct block_operations ide_operations = {ide_read, ide_write, ide_read_multiple,
+                                                 ide_write_multiple};
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
-static void select_sector(struct ata_disk* d, block_sector_t sec_no) {
+   writes SEC_NO and the transfer length CNT to the disk's sector
+   selection registers.  (We use LBA mode.) */
+static void select_sector(struct ata_disk* d, block_sector_t sec_no, size_t cnt) {
   struct channel* c = d->channel;
 
   ASSERT(sec_no < (1UL << 28));
+  ASSERT(cnt >= 1 && cnt <= MAX_SECTORS_PER_CMD);
 
   select_device_wait(d);
-  outb(reg_nsect(c), 1);
+  outb(reg_nsect(c), cnt == MAX_SECTORS_PER_CMD ? 0 : cnt);
   outb(reg_lbal(c), sec_no);
   outb(reg_lbam(c), sec_no >> 8);
   outb(reg_lbah(c), (sec_no >> 16));
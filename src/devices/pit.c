@@ -49,29 +49,76 @@ void pit_configure_channel(int channel, int mode, int frequency) {
   ASSERT(channel == 0 || channel == 2);
   ASSERT(mode == 2 || mode == 3);
 
+  /* A count of 65536 truncates to 0, as the PIT expects. */
+  count = pit_frequency_to_count(frequency);
+
+  /* Configure the PIT mode and load its counters. */
+  old_level = intr_disable();
+  outb(PIT_PORT_CONTROL, (channel << 6) | 0x30 | (mode << 1));
+  outb(PIT_PORT_COUNTER(channel), count);
+  outb(PIT_PORT_COUNTER(channel), count >> 8);
+  intr_set_level(old_level);
+}
+
+/* Returns the PIT counter value, in PIT cycles, that makes a
+   channel in mode 2 or 3 run at FREQUENCY Hz.  A return value of
+   65536 is loaded into the counter as 0. */
+unsigned pit_frequency_to_count(int frequency) {
   /* Convert FREQUENCY to a PIT counter value.  The PIT has a
      clock that runs at PIT_HZ cycles per second.  We must
      translate FREQUENCY into a number of these cycles. */
   if (frequency < 19) {
     /* Frequency is too low: the quotient would overflow the
-         16-bit counter.  Force it to 0, which the PIT treats as
-         65536, the highest possible count.  This yields a 18.2
+         16-bit counter.  Use 65536, the highest possible count,
+         which is loaded into the PIT as 0.  This yields a 18.2
          Hz timer, approximately. */
-    count = 0;
+    return 65536;
   } else if (frequency > PIT_HZ) {
     /* Frequency is too high: the quotient would underflow to
          0, which the PIT would interpret as 65536.  A count of 1
          is illegal in mode 2, so we force it to 2, which yields
          a 596.590 kHz timer, approximately.  (This timer rate is
          probably too fast to be useful anyhow.) */
-    count = 2;
+    return 2;
   } else
-    count = (PIT_HZ + frequency / 2) / frequency;
+    return (PIT_HZ + frequency / 2) / frequency;
+}
+
+/* Configures CHANNEL in mode 0, "interrupt on terminal count":
+   its output goes high once, COUNT PIT cycles from now, and
+   stays high until the channel is reprogrammed.  On channel 0
+   this raises a single timer interrupt.  COUNT must be between
+   1 and 65535. */
+void pit_configure_oneshot(int channel, unsigned count) {
+  enum intr_level old_level;
+
+  ASSERT(channel == 0 || channel == 2);
+  ASSERT(count >= 1 && count <= 0xffff);
 
-  /* Configure the PIT mode and load its counters. */
   old_level = intr_disable();
-  outb(PIT_PORT_CONTROL, (channel << 6) | 0x30 | (mode << 1));
+  outb(PIT_PORT_CONTROL, (channel << 6) | 0x30);
   outb(PIT_PORT_COUNTER(channel), count);
   outb(PIT_PORT_COUNTER(channel), count >> 8);
   intr_set_level(old_level);
 }
+
+/* Returns the current value of CHANNEL's counter, that is, the
+   number of PIT cycles left in the current period (modes 2 and
+   3) or until terminal count (mode 0).  After terminal count in
+   mode 0 the counter keeps counting down from 0xffff. */
+unsigned pit_read_count(int channel) {
+  enum intr_level old_level;
+  unsigned count;
+
+  ASSERT(channel == 0 || channel == 2);
+
+  /* Latch the counter so that the two bytes read below come
+     from the same value. */
+  old_level = intr_disable();
+  outb(PIT_PORT_CONTROL, channel << 6);
+  count = inb(PIT_PORT_COUNTER(channel));
+  count |= inb(PIT_PORT_COUNTER(channel)) << 8;
+  intr_set_level(old_level);
+
+  return count;
+}
@@ -4,5 +4,8 @@
 #include <stdint.h>
 
 void pit_configure_channel(int channel, int mode, int frequency);
+void pit_configure_oneshot(int channel, unsigned count);
+unsigned pit_read_count(int channel);
+unsigned pit_frequency_to_count(int frequency);
 
 #endif /* devices/pit.h */
@@ -24,20 +24,68 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* TSC clock.  Nanoseconds elapsed since TSC_BASE, the
+   time-stamp counter at timer_init(), are (cycles * TSC_MULT) >>
+   TSC_SHIFT.  TSC_MULT is 0 until timer_calibrate() measures the
+   TSC rate against the PIT. */
+static uint64_t tsc_base;
+static uint64_t tsc_per_sec;
+static uint32_t tsc_mult;
+static int tsc_shift;
+
+/* Number of timer ticks over which the TSC rate is measured. */
+#define TSC_CALIBRATE_TICKS 8
+
+/* Tickless idle.  When enabled, the idle thread switches the PIT
+   to one-shot mode before it halts, so that the next timer
+   interrupt comes at the next sleeping thread's wakeup tick
+   instead of at every tick.  The ticks it sleeps through are
+   accounted for when the CPU wakes up. */
+static bool tickless;
+
+/* PIT cycles per timer tick. */
+static unsigned tick_count;
+
+/* While a one-shot is armed, the number of ticks it covers and
+   the PIT count it was loaded with.  ONESHOT_TICKS is 0 while
+   the PIT is in periodic mode. */
+static int64_t oneshot_ticks;
+static unsigned oneshot_count;
+
+/* Number of timer interrupts avoided by tickless idle. */
+static int64_t skipped_ticks;
+
+/* Fewest PIT cycles, about 50 us, that may be left before the
+   next interrupt when the PIT is reprogrammed.  Any closer and
+   the interrupt could fire before the new count is loaded. */
+#define ONESHOT_MARGIN 64
+
+/* Largest one-shot count.  Kept well below 0xffff so that after
+   terminal count, when the counter wraps around to 0xffff, it
+   cannot be mistaken for a count still running. */
+#define ONESHOT_MAX 0xf000
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
 static void real_time_delay(int64_t num, int32_t denom);
+static void skip_ticks(int64_t n);
+static void calibrate_tsc(void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
-   and registers the corresponding interrupt. */
-void timer_init(void) {
+   and registers the corresponding interrupt.  If TICKLESS_IDLE
+   is true, the timer stops ticking while the CPU is idle. */
+void timer_init(bool tickless_idle) {
+  tickless = tickless_idle;
+  tsc_base = timer_cycles();
+  tick_count = pit_frequency_to_count(TIMER_FREQ);
   pit_configure_channel(0, 2, TIMER_FREQ);
   intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays,
+   and the TSC clock behind timer_ns(). */
 void timer_calibrate(void) {
   unsigned high_bit, test_bit;
 
@@ -59,6 +107,8 @@ void timer_calibrate(void) {
       loops_per_tick |= test_bit;
 
   printf("%'" PRIu64 " loops/s.\n", (uint64_t)loops_per_tick * TIMER_FREQ);
+
+  calibrate_tsc();
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -73,6 +123,31 @@ int64_t timer_ticks(void) {
    should be a value once returned by timer_ticks(). */
 int64_t timer_elapsed(int64_t then) { return timer_ticks() - then; }
 
+/* Returns the CPU's time-stamp counter, which counts up at a
+   constant rate (on CPUs with an invariant TSC, which includes
+   every CPU that QEMU and Bochs emulate). */
+uint64_t timer_cycles(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+/* Returns the number of nanoseconds since the timer was
+   initialized.  Before timer_calibrate(), the result only has
+   timer tick resolution. */
+int64_t timer_ns(void) {
+  uint64_t cycles;
+
+  if (tsc_mult == 0)
+    return timer_ticks() * (1000 * 1000 * 1000 / TIMER_FREQ);
+
+  /* Multiply the high and low halves separately, so that the
+     product cannot overflow for centuries of uptime. */
+  cycles = timer_cycles() - tsc_base;
+  return (((cycles >> 32) * tsc_mult) << (32 - tsc_shift)) +
+         (((cycles & 0xffffffff) * tsc_mult) >> tsc_shift);
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void timer_sleep(int64_t ticks) {
@@ -121,17 +196,141 @@ void timer_udelay(int64_t us) { real_time_delay(us, 1000 * 1000); }
    instead if interrupts are enabled.*/
 void timer_ndelay(int64_t ns) { real_time_delay(ns, 1000 * 1000 * 1000); }
 
-/* Prints timer statistics. */
-void timer_print_stats(void) { printf("Timer: %" PRId64 " ticks\n", timer_ticks()); }
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  With tickless idle, unless a sleeping thread
+   is due within a tick, switches the PIT to one-shot mode so
+   that the next timer interrupt comes at the earliest sleeper's
+   wakeup tick, or as close to it as the PIT's 16-bit counter
+   reaches. */
+void timer_idle_enter(void) {
+  int64_t skip, max_skip;
+  unsigned left;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  if (!tickless || oneshot_ticks != 0)
+    return;
+
+  /* LEFT is the number of PIT cycles until the next tick.  Stay
+     periodic if that tick is too close, or if it has already
+     been raised and is waiting for interrupts to come back on,
+     since switching modes now would lose it. */
+  left = pit_read_count(0);
+  if (left < ONESHOT_MARGIN || intr_is_pending(0x20))
+    return;
+
+  skip = thread_next_wakeup() - ticks;
+  max_skip = (ONESHOT_MAX - left) / tick_count + 1;
+  if (skip > max_skip)
+    skip = max_skip;
+  if (skip < 2)
+    return;
+
+  oneshot_ticks = skip;
+  oneshot_count = left + (skip - 1) * tick_count;
+  pit_configure_oneshot(0, oneshot_count);
+}
 
+/* Called by the scheduler, with interrupts off, whenever the
+   idle thread gives up the CPU.  If a one-shot armed by
+   timer_idle_enter() is still counting down, accounts for the
+   ticks that have already passed and rearms it for just the
+   next tick, after which the timer interrupt restores periodic
+   mode. */
+void timer_idle_exit(void) {
+  int64_t passed;
+  unsigned left;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  if (oneshot_ticks <= 1)
+    return;
+
+  /* If the one-shot has expired, or is about to, leave it to
+     timer_interrupt(). */
+  left = pit_read_count(0);
+  if (left < ONESHOT_MARGIN || left > oneshot_count || intr_is_pending(0x20))
+    return;
+
+  /* The one-shot ends on a tick, and earlier ticks fall every
+     TICK_COUNT cycles before that, so the next tick is
+     LEFT % TICK_COUNT cycles away. */
+  passed = oneshot_ticks - 1 - left / tick_count;
+  left %= tick_count;
+  if (left == 0) {
+    passed++;
+    left = tick_count;
+  }
+  skip_ticks(passed);
+
+  oneshot_ticks = 1;
+  oneshot_count = left;
+  pit_configure_oneshot(0, left);
+}
+
+/* Prints timer statistics. */
+void timer_print_stats(void) {
+  printf("Timer: %" PRId64 " ticks\n", timer_ticks());
+  printf("Timer: %'" PRIu64 " TSC cycles/s\n", tsc_per_sec);
+  if (tickless)
+    printf("Timer: %" PRId64 " ticks skipped by tickless idle\n", skipped_ticks);
+}
 
 /* Timer interrupt handler. */
 static void timer_interrupt(struct intr_frame* args UNUSED) {
+  if (oneshot_ticks != 0) {
+    /* A one-shot armed by timer_idle_enter() has expired.  Catch
+       up on the ticks before this one and resume ticking. */
+    skip_ticks(oneshot_ticks - 1);
+    oneshot_ticks = 0;
+    pit_configure_channel(0, 2, TIMER_FREQ);
+  }
+
   ticks++;
   check_sleep_list();
   thread_tick();
 }
 
+/* Accounts for N timer ticks that passed without a timer
+   interrupt while the idle thread was running in tickless
+   mode. */
+static void skip_ticks(int64_t n) {
+  skipped_ticks += n;
+  while (n-- > 0) {
+    ticks++;
+    check_sleep_list();
+    thread_idle_tick();
+  }
+}
+
+/* Measures the rate of the TSC over TSC_CALIBRATE_TICKS timer
+   ticks and sets up the conversion from cycles to nanoseconds
+   used by timer_ns(). */
+static void calibrate_tsc(void) {
+  int64_t start;
+  uint64_t tsc, mult;
+  int shift;
+
+  /* Start on a tick boundary. */
+  start = ticks;
+  while (ticks == start)
+    barrier();
+  start = ticks;
+  tsc = timer_cycles();
+  while (ticks != start + TSC_CALIBRATE_TICKS)
+    barrier();
+  tsc = timer_cycles() - tsc;
+  tsc_per_sec = tsc * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+  if (tsc_per_sec == 0)
+    return;
+
+  /* Nanoseconds per cycle, as a 32-bit fixed-point fraction with
+     as many fraction bits as fit. */
+  mult = (1000ULL * 1000 * 1000 << 32) / tsc_per_sec;
+  for (shift = 32; mult > UINT32_MAX; shift--)
+    mult >>= 1;
+  tsc_shift = shift;
+  tsc_mult = mult;
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool too_many_loops(unsigned loops) {
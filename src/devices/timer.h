@@ -2,17 +2,22 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
-void timer_init(void);
+void timer_init(bool tickless_idle);
 void timer_calibrate(void);
 
 int64_t timer_ticks(void);
 int64_t timer_elapsed(int64_t);
 
+/* High-resolution clock. */
+uint64_t timer_cycles(void);
+int64_t timer_ns(void);
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep(int64_t ticks);
 void timer_msleep(int64_t milliseconds);
@@ -24,6 +29,10 @@ void timer_mdelay(int64_t milliseconds);
 void timer_udelay(int64_t microseconds);
 void timer_ndelay(int64_t nanoseconds);
 
+/* Tickless idle. */
+void timer_idle_enter(void);
+void timer_idle_exit(void);
+
 void timer_print_stats(void);
 
 #endif /* devices/timer.h */
@@ -6,6 +6,10 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#ifdef VM
+#include "vm/frame.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -31,8 +35,14 @@ static block_sector_t byte_to_sector(const struct inode* inode, off_t pos) {
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of in-memory inodes. */
+static struct slab_cache inode_cache;
+
 /* Initializes the inode module. */
-void inode_init(void) { list_init(&open_inodes); }
+void inode_init(void) {
+  list_init(&open_inodes);
+  slab_cache_init(&inode_cache, "inode", sizeof(struct inode), NULL);
+}
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
@@ -87,7 +97,7 @@ struct inode* inode_open(block_sector_t sector) {
   }
 
   /* Allocate memory. */
-  inode = malloc(sizeof *inode);
+  inode = slab_alloc(&inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -126,11 +136,14 @@ void inode_close(struct inode* inode) {
 
     /* Deallocate blocks if removed. */
     if (inode->removed) {
+#ifdef VM
+      frame_cache_invalidate(inode, 0, inode_length(inode));
+#endif
       free_map_release(inode->sector, 1);
       free_map_release(inode->data.start, bytes_to_sectors(inode->data.length));
     }
 
-    free(inode);
+    slab_free(&inode_cache, inode);
   }
 }
 
@@ -202,6 +215,11 @@ off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t
   if (inode->deny_write_cnt)
     return 0;
 
+#ifdef VM
+  /* Cached pages of this file are about to go stale. */
+  frame_cache_invalidate(inode, offset, size);
+#endif
+
   while (size > 0) {
     /* Sector to write, starting byte offset within sector. */
     block_sector_t sector_idx = byte_to_sector(inode, offset);
@@ -0,0 +1,279 @@
+/* Red-black tree.
+
+   The algorithms follow [CLRS] chapter 13, with null pointers in
+   place of the sentinel leaf.
+
+   See rbtree.h for basic information. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void rotate_left(struct rbtree*, struct rb_elem*);
+static void rotate_right(struct rbtree*, struct rb_elem*);
+static void replace_child(struct rbtree*, struct rb_elem* old, struct rb_elem* new);
+static void insert_fixup(struct rbtree*, struct rb_elem*);
+static void remove_fixup(struct rbtree*, struct rb_elem*, struct rb_elem* parent);
+static struct rb_elem* subtree_min(struct rb_elem*);
+
+/* Returns true if E is a red element, false if E is black or
+   null. */
+static inline bool is_red(const struct rb_elem* e) { return e != NULL && e->red; }
+
+/* Initializes tree T to compare elements using LESS, given
+   auxiliary data AUX. */
+void rb_init(struct rbtree* t, rb_less_func* less, void* aux) {
+  t->root = NULL;
+  t->min = NULL;
+  t->elem_cnt = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/* Inserts E into tree T, after any elements equal to it. */
+void rb_insert(struct rbtree* t, struct rb_elem* e) {
+  struct rb_elem* parent = NULL;
+  struct rb_elem** link = &t->root;
+  bool leftmost = true;
+
+  ASSERT(e != NULL);
+
+  while (*link != NULL) {
+    parent = *link;
+    if (t->less(e, parent, t->aux))
+      link = &parent->left;
+    else {
+      link = &parent->right;
+      leftmost = false;
+    }
+  }
+
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+  if (leftmost)
+    t->min = e;
+  t->elem_cnt++;
+
+  insert_fixup(t, e);
+}
+
+/* Removes E, which must be in tree T, from T. */
+void rb_remove(struct rbtree* t, struct rb_elem* e) {
+  struct rb_elem* child;
+  struct rb_elem* parent;
+  bool removed_red;
+
+  ASSERT(e != NULL);
+  ASSERT(t->elem_cnt > 0);
+
+  if (t->min == e)
+    t->min = rb_next(e);
+
+  if (e->left == NULL || e->right == NULL) {
+    /* E has at most one child, which takes its place. */
+    child = e->left != NULL ? e->left : e->right;
+    parent = e->parent;
+    removed_red = e->red;
+    replace_child(t, e, child);
+    if (child != NULL)
+      child->parent = parent;
+  } else {
+    /* E's successor S has no left child.  S moves into E's
+       place, and S's right child takes S's old place. */
+    struct rb_elem* s = subtree_min(e->right);
+
+    child = s->right;
+    removed_red = s->red;
+    if (s->parent == e)
+      parent = s;
+    else {
+      parent = s->parent;
+      parent->left = child;
+      if (child != NULL)
+        child->parent = parent;
+      s->right = e->right;
+      s->right->parent = s;
+    }
+    replace_child(t, e, s);
+    s->parent = e->parent;
+    s->left = e->left;
+    s->left->parent = s;
+    s->red = e->red;
+  }
+  t->elem_cnt--;
+
+  if (!removed_red)
+    remove_fixup(t, child, parent);
+}
+
+/* Returns the smallest element in tree T, or a null pointer if
+   T is empty. */
+struct rb_elem* rb_min(const struct rbtree* t) { return t->min; }
+
+/* Returns the element after E in its tree, or a null pointer if
+   E is the largest element. */
+struct rb_elem* rb_next(struct rb_elem* e) {
+  if (e->right != NULL)
+    return subtree_min(e->right);
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t rb_size(const struct rbtree* t) { return t->elem_cnt; }
+
+/* Returns true if T contains no elements, false otherwise. */
+bool rb_empty(const struct rbtree* t) { return t->elem_cnt == 0; }
+
+/* Returns the smallest element in the subtree rooted at E. */
+static struct rb_elem* subtree_min(struct rb_elem* e) {
+  while (e->left != NULL)
+    e = e->left;
+  return e;
+}
+
+/* Makes NEW take OLD's place as a child of OLD's parent, or as
+   the root of T.  Does not change NEW's own parent pointer. */
+static void replace_child(struct rbtree* t, struct rb_elem* old, struct rb_elem* new) {
+  if (old->parent == NULL)
+    t->root = new;
+  else if (old == old->parent->left)
+    old->parent->left = new;
+  else
+    old->parent->right = new;
+}
+
+/* Rotates the subtree rooted at E to the left, making E's right
+   child its parent. */
+static void rotate_left(struct rbtree* t, struct rb_elem* e) {
+  struct rb_elem* r = e->right;
+
+  e->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = e;
+  r->parent = e->parent;
+  replace_child(t, e, r);
+  r->left = e;
+  e->parent = r;
+}
+
+/* Rotates the subtree rooted at E to the right, making E's left
+   child its parent. */
+static void rotate_right(struct rbtree* t, struct rb_elem* e) {
+  struct rb_elem* l = e->left;
+
+  e->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = e;
+  l->parent = e->parent;
+  replace_child(t, e, l);
+  l->right = e;
+  e->parent = l;
+}
+
+/* Restores the red-black properties after inserting red element
+   E into tree T. */
+static void insert_fixup(struct rbtree* t, struct rb_elem* e) {
+  while (is_red(e->parent)) {
+    struct rb_elem* parent = e->parent;
+    struct rb_elem* grandparent = parent->parent;
+
+    if (parent == grandparent->left) {
+      struct rb_elem* uncle = grandparent->right;
+      if (is_red(uncle)) {
+        parent->red = uncle->red = false;
+        grandparent->red = true;
+        e = grandparent;
+      } else {
+        if (e == parent->right) {
+          rotate_left(t, parent);
+          e = parent;
+          parent = e->parent;
+        }
+        parent->red = false;
+        grandparent->red = true;
+        rotate_right(t, grandparent);
+      }
+    } else {
+      struct rb_elem* uncle = grandparent->left;
+      if (is_red(uncle)) {
+        parent->red = uncle->red = false;
+        grandparent->red = true;
+        e = grandparent;
+      } else {
+        if (e == parent->left) {
+          rotate_right(t, parent);
+          e = parent;
+          parent = e->parent;
+        }
+        parent->red = false;
+        grandparent->red = true;
+        rotate_left(t, grandparent);
+      }
+    }
+  }
+  t->root->red = false;
+}
+
+/* Restores the red-black properties of tree T after a black
+   element was removed, leaving E, which may be null, one black
+   element short.  PARENT is E's parent. */
+static void remove_fixup(struct rbtree* t, struct rb_elem* e, struct rb_elem* parent) {
+  while (e != t->root && !is_red(e)) {
+    if (e == parent->left) {
+      struct rb_elem* sibling = parent->right;
+      if (is_red(sibling)) {
+        sibling->red = false;
+        parent->red = true;
+        rotate_left(t, parent);
+        sibling = parent->right;
+      }
+      if (!is_red(sibling->left) && !is_red(sibling->right)) {
+        sibling->red = true;
+        e = parent;
+        parent = e->parent;
+      } else {
+        if (!is_red(sibling->right)) {
+          sibling->left->red = false;
+          sibling->red = true;
+          rotate_right(t, sibling);
+          sibling = parent->right;
+        }
+        sibling->red = parent->red;
+        parent->red = false;
+        sibling->right->red = false;
+        rotate_left(t, parent);
+        e = t->root;
+      }
+    } else {
+      struct rb_elem* sibling = parent->left;
+      if (is_red(sibling)) {
+        sibling->red = false;
+        parent->red = true;
+        rotate_right(t, parent);
+        sibling = parent->left;
+      }
+      if (!is_red(sibling->left) && !is_red(sibling->right)) {
+        sibling->red = true;
+        e = parent;
+        parent = e->parent;
+      } else {
+        if (!is_red(sibling->left)) {
+          sibling->right->red = false;
+          sibling->red = true;
+          rotate_left(t, sibling);
+          sibling = parent->left;
+        }
+        sibling->red = parent->red;
+        parent->red = false;
+        sibling->left->red = false;
+        rotate_right(t, parent);
+        e = t->root;
+      }
+    }
+  }
+  if (e != NULL)
+    e->red = false;
+}
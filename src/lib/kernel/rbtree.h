@@ -0,0 +1,72 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A red-black tree is a binary search tree that keeps itself
+   balanced, so that insertion, deletion, and search take
+   O(log n) time in a tree of n elements.  This implementation
+   also remembers the tree's smallest element, so that finding it
+   takes O(1) time, which suits priority queues such as a
+   scheduler's run queue.
+
+   Like lists and hash tables, the tree does not use dynamic
+   allocation.  Each structure that can be in a tree must embed a
+   struct rb_elem member, and the rb_entry macro converts from a
+   struct rb_elem back to the structure that contains it.  Refer
+   to lib/kernel/list.h for a detailed explanation of the
+   technique.
+
+   Elements that compare equal are allowed.  A newly inserted
+   element goes after all the elements equal to it, so equal
+   elements leave in first-in, first-out order when the smallest
+   element is removed repeatedly. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree element. */
+struct rb_elem {
+  struct rb_elem* parent; /* Parent, or null for the root. */
+  struct rb_elem* left;   /* Left child, or null. */
+  struct rb_elem* right;  /* Right child, or null. */
+  bool red;               /* Red or black? */
+};
+
+/* Converts pointer to tree element RB_ELEM into a pointer to the
+   structure that RB_ELEM is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                                                          \
+  ((STRUCT*)((uint8_t*)&(RB_ELEM)->parent - offsetof(STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func(const struct rb_elem* a, const struct rb_elem* b, void* aux);
+
+/* Red-black tree. */
+struct rbtree {
+  struct rb_elem* root; /* Root, or null if the tree is empty. */
+  struct rb_elem* min;  /* Smallest element, or null. */
+  size_t elem_cnt;      /* Number of elements in tree. */
+  rb_less_func* less;   /* Comparison function. */
+  void* aux;            /* Auxiliary data for `less'. */
+};
+
+void rb_init(struct rbtree*, rb_less_func*, void* aux);
+
+/* Insertion and deletion. */
+void rb_insert(struct rbtree*, struct rb_elem*);
+void rb_remove(struct rbtree*, struct rb_elem*);
+
+/* Traversal. */
+struct rb_elem* rb_min(const struct rbtree*);
+struct rb_elem* rb_next(struct rb_elem*);
+
+/* Information. */
+size_t rb_size(const struct rbtree*);
+bool rb_empty(const struct rbtree*);
+
+#endif /* lib/kernel/rbtree.h */
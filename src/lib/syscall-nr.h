@@ -39,7 +39,14 @@ enum {
   SYS_MKDIR,   /* Create a directory. */
   SYS_READDIR, /* Reads a directory entry. */
   SYS_ISDIR,   /* Tests if a fd represents a directory. */
-  SYS_INUMBER  /* Returns the inode number for a fd. */
+  SYS_INUMBER, /* Returns the inode number for a fd. */
+
+  /* Extensions. */
+  SYS_MADVISE,     /* Give advice about use of memory. */
+  SYS_SBRK,        /* Changes the size of the heap. */
+  SYS_CLOCK_NS,    /* Reads the nanosecond clock. */
+  SYS_SET_TICKETS, /* Sets the scheduling tickets of the current thread. */
+  SYS_RT_RESERVE   /* Reserves real-time CPU time for the current thread. */
 };
 
 #endif /* lib/syscall-nr.h */
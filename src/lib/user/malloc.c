@@ -0,0 +1,243 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A size-class memory allocator for user programs.
+
+   Each request, plus an 8-byte header, is rounded up to the next
+   size class: 16, 24, and 32 bytes, then four classes between
+   each pair of powers of 2 (40, 48, 56, 64, 80, ...) up to
+   MAX_BLOCK, so no more than about 20% of a block is wasted on
+   rounding.  Each class has a stack of free blocks.  malloc()
+   pops a block from its class's stack, and free() pushes the
+   block back onto the stack named by its header.
+
+   When a class's stack is empty, malloc() extends the heap with
+   sbrk() by REFILL_BYTES (or one block, if that is bigger),
+   carves the new memory into blocks of that class, keeps one,
+   and pushes the rest.  Memory is never given back to the
+   kernel, and a free block is only ever reused for its own size
+   class.
+
+   Threads of a process share the free stacks without taking
+   any locks.  Pushes and pops are single compare-and-swap
+   operations on the stack's top pointer paired with a
+   generation count, which changes on every operation, so a pop
+   that raced with other threads is simply retried.  Refills need
+   no lock either, because the kernel hands out each sbrk()
+   extension to just one thread.  Programs that use malloc() must
+   not shrink the heap with brk() or sbrk() themselves, since
+   freed blocks stay on the stacks. */
+
+/* Largest block, including its header. */
+#define MAX_BLOCK (1u << 30)
+
+/* Number of size classes: 16, 24, 32, then four for each
+   doubling up to MAX_BLOCK. */
+#define CLASS_CNT 103
+
+/* Bytes to obtain from sbrk() when a class runs out of blocks. */
+#define REFILL_BYTES (16 * 1024)
+
+/* Header of each block, free or in use. */
+struct block {
+  struct block* next; /* Next block on a free stack. */
+  unsigned class;     /* Size class index. */
+};
+
+/* A stack of free blocks. */
+union free_stack {
+  struct {
+    struct block* top; /* Most recently freed block. */
+    unsigned gen;      /* Incremented by every push and pop. */
+  } s;
+  uint64_t word; /* Both of the above, for compare-and-swap. */
+} __attribute__((aligned(8)));
+
+/* Free blocks of each size class. */
+static union free_stack free_stacks[CLASS_CNT];
+
+static int size_to_class(size_t size);
+static size_t class_size(int class);
+static struct block* refill(int class);
+static struct block* pop(union free_stack*);
+static void push(union free_stack*, struct block* first, struct block* last);
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void* malloc(size_t size) {
+  struct block* b;
+  int class;
+
+  /* A null pointer satisfies a request for 0 bytes. */
+  if (size == 0)
+    return NULL;
+
+  class = size_to_class(size);
+  if (class < 0)
+    return NULL;
+
+  b = pop(&free_stacks[class]);
+  if (b == NULL) {
+    b = refill(class);
+    if (b == NULL)
+      return NULL;
+  }
+  b->class = class;
+  return b + 1;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void* calloc(size_t a, size_t b) {
+  void* p;
+  size_t size;
+
+  /* Calculate block size and make sure it fits in size_t. */
+  size = a * b;
+  if (a != 0 && size / a != b)
+    return NULL;
+
+  /* Allocate and zero memory. */
+  p = malloc(size);
+  if (p != NULL)
+    memset(p, 0, size);
+
+  return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void* realloc(void* old_block, size_t new_size) {
+  if (new_size == 0) {
+    free(old_block);
+    return NULL;
+  } else if (old_block == NULL) {
+    return malloc(new_size);
+  } else {
+    struct block* b = (struct block*)old_block - 1;
+    size_t old_size = class_size(b->class) - sizeof *b;
+    void* new_block;
+
+    /* Keep the block if NEW_SIZE still fits. */
+    if (new_size <= old_size)
+      return old_block;
+
+    new_block = malloc(new_size);
+    if (new_block != NULL) {
+      memcpy(new_block, old_block, old_size);
+      free(old_block);
+    }
+    return new_block;
+  }
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void free(void* p) {
+  if (p != NULL) {
+    struct block* b = (struct block*)p - 1;
+
+    ASSERT(b->class < CLASS_CNT);
+    push(&free_stacks[b->class], b, b);
+  }
+}
+
+/* Returns the smallest size class that holds SIZE bytes plus a
+   header, or -1 if there is none. */
+static int size_to_class(size_t size) {
+  size_t base = 32;
+  int class = 2;
+
+  if (size > MAX_BLOCK - sizeof(struct block))
+    return -1;
+  size += sizeof(struct block);
+  if (size <= 32)
+    return size <= 16 ? 0 : DIV_ROUND_UP(size, 8) - 2;
+
+  /* Find the power of 2 just below SIZE, then the quarter step
+     above it. */
+  while (base * 2 < size) {
+    base *= 2;
+    class += 4;
+  }
+  return class + DIV_ROUND_UP(size - base, base / 4);
+}
+
+/* Returns the size of a block of size class CLASS, including its
+   header. */
+static size_t class_size(int class) {
+  size_t base;
+
+  if (class < 3)
+    return 16 + 8 * class;
+  base = (size_t)32 << ((class - 3) / 4);
+  return base + base / 4 * ((class - 3) % 4 + 1);
+}
+
+/* Extends the heap by a batch of blocks of size class CLASS,
+   pushes all but one onto the class's free stack, and returns
+   the remaining one.  Returns a null pointer if the heap cannot
+   grow. */
+static struct block* refill(int class) {
+  size_t size = class_size(class);
+  size_t cnt = size < REFILL_BYTES ? REFILL_BYTES / size : 1;
+  uint8_t* start;
+  uint8_t* p;
+  size_t i;
+
+  /* Someone else may have called brk() and left the break
+     misaligned, so ask for enough to align the blocks. */
+  start = sbrk(cnt * size + 7);
+  if (start == SBRK_FAILED)
+    return NULL;
+  start = (uint8_t*)ROUND_UP((uintptr_t)start, 8);
+
+  /* Chain blocks 1 through CNT - 1 and push them all at once. */
+  if (cnt > 1) {
+    for (i = 1, p = start + size; i < cnt - 1; i++, p += size)
+      ((struct block*)p)->next = (struct block*)(p + size);
+    push(&free_stacks[class], (struct block*)(start + size), (struct block*)p);
+  }
+  return (struct block*)start;
+}
+
+/* Pops and returns the top block of STACK, or returns a null
+   pointer if STACK is empty. */
+static struct block* pop(union free_stack* stack) {
+  union free_stack old, new;
+
+  /* The two halves of OLD may be read at different times, and
+     another thread may take OLD's top block and reuse it before
+     we read its NEXT.  Either way the generation no longer
+     matches and the swap fails.  TOP always points into the
+     heap, which never shrinks, so reading its NEXT is safe. */
+  do {
+    old.word = stack->word;
+    if (old.s.top == NULL)
+      return NULL;
+    new.s.top = old.s.top->next;
+    new.s.gen = old.s.gen + 1;
+  } while (!__sync_bool_compare_and_swap(&stack->word, old.word, new.word));
+  return old.s.top;
+}
+
+/* Pushes the chain of blocks from FIRST to LAST, linked through
+   their NEXT members, onto STACK. */
+static void push(union free_stack* stack, struct block* first, struct block* last) {
+  union free_stack old, new;
+
+  do {
+    old.word = stack->word;
+    last->next = old.s.top;
+    new.s.top = first;
+    new.s.gen = old.s.gen + 1;
+  } while (!__sync_bool_compare_and_swap(&stack->word, old.word, new.word));
+}
@@ -0,0 +1,11 @@
+#ifndef __LIB_USER_MALLOC_H
+#define __LIB_USER_MALLOC_H
+
+#include <stddef.h>
+
+void* malloc(size_t) __attribute__((malloc));
+void* calloc(size_t, size_t) __attribute__((malloc));
+void* realloc(void*, size_t);
+void free(void*);
+
+#endif /* lib/user/malloc.h */
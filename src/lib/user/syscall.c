@@ -14,6 +14,19 @@
     retval;                                                                                        \
   })
 
+/* Invokes syscall NUMBER, passing no arguments, and returns the
+   return value as an `int64_t', which the kernel passes back in
+   EDX:EAX. */
+#define syscall0ll(NUMBER)                                                                         \
+  ({                                                                                               \
+    int64_t retval;                                                                                \
+    asm volatile("pushl %[number]; int $0x30; addl $4, %%esp"                                      \
+                 : "=A"(retval)                                                                    \
+                 : [number] "i"(NUMBER)                                                            \
+                 : "memory");                                                                      \
+    retval;                                                                                        \
+  })
+
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
 #define syscall1(NUMBER, ARG0)                                                                     \
@@ -106,6 +119,10 @@ mapid_t mmap(int fd, void* addr) { return syscall2(SYS_MMAP, fd, addr); }
 
 void munmap(mapid_t mapid) { syscall1(SYS_MUNMAP, mapid); }
 
+bool madvise(void* addr, size_t length, int advice) {
+  return syscall3(SYS_MADVISE, addr, length, advice);
+}
+
 bool chdir(const char* dir) { return syscall1(SYS_CHDIR, dir); }
 
 bool mkdir(const char* dir) { return syscall1(SYS_MKDIR, dir); }
@@ -158,3 +175,16 @@ void sema_up(sema_t* sema) {
 }
 
 tid_t get_tid(void) { return syscall0(SYS_GET_TID); }
+
+void* sbrk(intptr_t increment) { return (void*)syscall1(SYS_SBRK, increment); }
+
+bool brk(void* end) {
+  char* cur = sbrk(0);
+  return sbrk((char*)end - cur) != SBRK_FAILED;
+}
+
+int64_t clock_ns(void) { return syscall0ll(SYS_CLOCK_NS); }
+
+bool set_tickets(int tickets) { return syscall1(SYS_SET_TICKETS, tickets); }
+
+bool rt_reserve(int period, int budget) { return syscall2(SYS_RT_RESERVE, period, budget); }
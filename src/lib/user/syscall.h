@@ -2,6 +2,8 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <debug.h>
 #include <pthread.h>
 
@@ -17,6 +19,16 @@ typedef char sema_t;
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t)-1)
 
+/* Return value of sbrk() on failure. */
+#define SBRK_FAILED ((void*)-1)
+
+/* Advice for madvise(). */
+#define MADV_NORMAL 0     /* No special treatment. */
+#define MADV_SEQUENTIAL 1 /* Expect sequential access. */
+#define MADV_RANDOM 2     /* Expect random access. */
+#define MADV_WILLNEED 3   /* Expect access soon. */
+#define MADV_DONTNEED 4   /* Do not expect access soon. */
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -50,10 +62,16 @@ bool sema_init(sema_t* sema, int val);
 void sema_down(sema_t* sema);
 void sema_up(sema_t* sema);
 tid_t get_tid(void);
+void* sbrk(intptr_t increment);
+bool brk(void* end);
+int64_t clock_ns(void);
+bool set_tickets(int tickets);
+bool rt_reserve(int period, int budget);
 
 /* Project 3 and optionally project 4. */
 mapid_t mmap(int fd, void* addr);
 void munmap(mapid_t);
+bool madvise(void* addr, size_t length, int advice);
 
 /* Project 4 only. */
 bool chdir(const char* dir);
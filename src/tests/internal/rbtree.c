@@ -0,0 +1,127 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Inserts and removes elements in random order and checks the
+   red-black properties and the in-order traversal along the way.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a tree that we will test. */
+#define MAX_SIZE 64
+
+/* A tree element. */
+struct value {
+  struct rb_elem elem; /* Tree element. */
+  int value;           /* Item value. */
+  int seq;             /* Order of insertion. */
+  bool in_tree;        /* In the tree? */
+};
+
+static bool value_less(const struct rb_elem*, const struct rb_elem*, void*);
+static int verify_subtree(struct rb_elem*, struct rb_elem* parent, size_t* cnt);
+static void verify_tree(struct rbtree*);
+
+/* Test the red-black tree implementation. */
+void test(void) {
+  int size;
+
+  printf("testing various size trees:");
+  for (size = 1; size <= MAX_SIZE; size++) {
+    static struct value values[MAX_SIZE];
+    struct rbtree tree;
+    int seq = 0;
+    int i, step;
+
+    printf(" %d", size);
+    rb_init(&tree, value_less, NULL);
+    for (i = 0; i < size; i++)
+      values[i].in_tree = false;
+
+    /* Toggle random elements in and out of the tree, with
+       values drawn from a small range so that there are many
+       duplicates. */
+    for (step = 0; step < size * 20; step++) {
+      struct value* v = &values[random_ulong() % size];
+
+      if (v->in_tree)
+        rb_remove(&tree, &v->elem);
+      else {
+        v->value = random_ulong() % (size / 4 + 1);
+        v->seq = seq++;
+        rb_insert(&tree, &v->elem);
+      }
+      v->in_tree = !v->in_tree;
+      verify_tree(&tree);
+    }
+
+    /* Empty the tree from the smallest element up. */
+    while (!rb_empty(&tree)) {
+      struct rb_elem* e = rb_min(&tree);
+      rb_remove(&tree, e);
+      rb_entry(e, struct value, elem)->in_tree = false;
+      verify_tree(&tree);
+    }
+  }
+
+  printf(" done\n");
+  printf("rbtree: PASS\n");
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool value_less(const struct rb_elem* a_, const struct rb_elem* b_, void* aux UNUSED) {
+  const struct value* a = rb_entry(a_, struct value, elem);
+  const struct value* b = rb_entry(b_, struct value, elem);
+
+  return a->value < b->value;
+}
+
+/* Verifies the parent pointers and red-black properties of the
+   subtree rooted at E, whose parent is PARENT, and adds its
+   number of elements to *CNT.  Returns the number of black
+   elements on each path from E to a leaf. */
+static int verify_subtree(struct rb_elem* e, struct rb_elem* parent, size_t* cnt) {
+  int left, right;
+
+  if (e == NULL)
+    return 1;
+  ASSERT(e->parent == parent);
+  if (e->red)
+    ASSERT((e->left == NULL || !e->left->red) && (e->right == NULL || !e->right->red));
+  left = verify_subtree(e->left, e, cnt);
+  right = verify_subtree(e->right, e, cnt);
+  ASSERT(left == right);
+  (*cnt)++;
+  return left + !e->red;
+}
+
+/* Verifies that TREE is a valid red-black tree whose traversal
+   visits values in order, with equal values in insertion
+   order. */
+static void verify_tree(struct rbtree* tree) {
+  struct value* prev = NULL;
+  struct rb_elem* e;
+  size_t cnt = 0;
+  size_t i = 0;
+
+  ASSERT(tree->root == NULL || !tree->root->red);
+  verify_subtree(tree->root, NULL, &cnt);
+  ASSERT(cnt == rb_size(tree));
+
+  for (e = rb_min(tree); e != NULL; e = rb_next(e), i++) {
+    struct value* v = rb_entry(e, struct value, elem);
+    ASSERT(v->in_tree);
+    ASSERT(prev == NULL || prev->value < v->value ||
+           (prev->value == v->value && prev->seq < v->seq));
+    prev = v;
+  }
+  ASSERT(i == cnt);
+}
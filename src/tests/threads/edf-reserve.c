@@ -0,0 +1,98 @@
+/* Checks EDF admission control and that real-time threads get
+   their reserved share of the CPU, without missing deadlines,
+   while a best-effort thread runs in the time left over.
+
+   Thread 0 reserves 3 ticks every 10 ticks and thread 1 reserves
+   5 ticks every 20 ticks, 30% and 25% of the CPU.  Thread 2 is
+   best effort.  All three spin for 10 seconds, counting the timer
+   ticks they see while running, so they should receive about
+   300, 250, and 450 ticks at 100 Hz. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 3
+
+struct thread_info {
+  int64_t start_time;
+  int64_t period;
+  int64_t budget;
+  int tick_count;
+  int misses;
+  struct semaphore* reserved;
+};
+
+static void load_thread(void* aux);
+
+void test_edf_reserve(void) {
+  static const int64_t periods[THREAD_CNT] = {10, 20, 0};
+  static const int64_t budgets[THREAD_CNT] = {3, 5, 0};
+  struct thread_info info[THREAD_CNT];
+  struct semaphore reserved;
+  int64_t start_time;
+  int i;
+
+  ASSERT(active_sched_policy == SCHED_EDF);
+
+  msg("reserve 11 of every 10 ticks: %s",
+      thread_set_reservation(10, 11) ? "admitted" : "rejected");
+
+  sema_init(&reserved, 0);
+  start_time = timer_ticks();
+  msg("Starting %d threads...", THREAD_CNT);
+  for (i = 0; i < THREAD_CNT; i++) {
+    struct thread_info* ti = &info[i];
+    char name[16];
+
+    ti->start_time = start_time;
+    ti->period = periods[i];
+    ti->budget = budgets[i];
+    ti->tick_count = 0;
+    ti->misses = 0;
+    ti->reserved = &reserved;
+
+    snprintf(name, sizeof name, "load %d", i);
+    thread_create(name, PRI_DEFAULT, load_thread, ti);
+  }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down(&reserved);
+
+  /* 55% of the CPU is reserved, so 40% more would exceed the
+     limit. */
+  msg("reserve 4 of every 10 ticks: %s",
+      thread_set_reservation(10, 4) ? "admitted" : "rejected");
+
+  msg("Sleeping 12 seconds to let threads run, please wait...");
+  timer_sleep(12 * TIMER_FREQ);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    msg("Thread %d reserving %" PRId64 " of %" PRId64 " ticks received %d ticks.", i,
+        info[i].budget, info[i].period, info[i].tick_count);
+  for (i = 0; i < THREAD_CNT; i++)
+    msg("Thread %d missed %d deadlines.", i, info[i].misses);
+}
+
+static void load_thread(void* ti_) {
+  struct thread_info* ti = ti_;
+  int64_t sleep_time = 1 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + 10 * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  if (ti->period != 0 && !thread_set_reservation(ti->period, ti->budget))
+    fail("reservation of %" PRId64 " of %" PRId64 " ticks rejected", ti->budget, ti->period);
+  sema_up(ti->reserved);
+
+  timer_sleep(sleep_time - timer_elapsed(ti->start_time));
+  while (timer_elapsed(ti->start_time) < spin_time) {
+    int64_t cur_time = timer_ticks();
+    if (cur_time != last_time)
+      ti->tick_count++;
+    last_time = cur_time;
+  }
+  ti->misses = thread_get_deadline_misses();
+}
@@ -0,0 +1,46 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "over-long budget was not rejected\n"
+  unless grep ($_ eq '(edf-reserve) reserve 11 of every 10 ticks: rejected', @output);
+fail "over-committed reservation was not rejected\n"
+  unless grep ($_ eq '(edf-reserve) reserve 4 of every 10 ticks: rejected', @output);
+
+# Each real-time thread's share of the ticks should match its
+# reservation, and the best-effort thread should get the rest,
+# to within 5% of all the ticks.
+my (@share, @ticks);
+my ($total_ticks) = 0;
+foreach (@output) {
+    my ($id, $budget, $period, $count)
+      = /Thread (\d+) reserving (\d+) of (\d+) ticks received (\d+) ticks\./
+      or next;
+    $share[$id] = $period ? $budget / $period : undef;
+    $ticks[$id] = $count;
+    $total_ticks += $count;
+}
+fail "expected 3 threads, got " . scalar (@ticks) . "\n" if @ticks != 3;
+fail "threads received no ticks\n" if $total_ticks == 0;
+
+my ($reserved) = 0;
+$reserved += $_ foreach grep (defined, @share);
+for my $id (0...$#ticks) {
+    my ($share) = defined $share[$id] ? $share[$id] : 1 - $reserved;
+    my ($expected) = $total_ticks * $share;
+    fail sprintf ("thread %d received %d ticks, expected about %d\n",
+		  $id, $ticks[$id], $expected)
+      if abs ($ticks[$id] - $expected) > $total_ticks * 0.05;
+}
+
+foreach (@output) {
+    my ($id, $misses) = /Thread (\d+) missed (\d+) deadlines\./ or next;
+    fail "thread $id missed $misses deadlines\n" if $misses != 0;
+}
+pass;
@@ -28,6 +28,7 @@ static const struct test threads_tests[] = {
     {"mt-matmul-2", test_mt_matmul_2},
     {"mt-matmul-4", test_mt_matmul_4},
     {"mt-matmul-16", test_mt_matmul_16},
+    {"thread-create-bench", test_thread_create_bench},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -36,7 +37,10 @@ static const struct test threads_tests[] = {
     {"mlfqs-fair-20", test_mlfqs_fair_20},
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
-    {"mlfqs-block", test_mlfqs_block},};
+    {"mlfqs-block", test_mlfqs_block},
+    {"stride-fair", test_stride_fair},
+    {"lottery-fair", test_lottery_fair},
+    {"edf-reserve", test_edf_reserve},};
 
 /* Runs the threads test named NAME. */
 void run_threads_test(const char* name) {
@@ -29,6 +29,7 @@ extern test_func test_mt_matmul_1;
 extern test_func test_mt_matmul_2;
 extern test_func test_mt_matmul_4;
 extern test_func test_mt_matmul_16;
+extern test_func test_thread_create_bench;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -38,6 +39,9 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_stride_fair;
+extern test_func test_lottery_fair;
+extern test_func test_edf_reserve;
 extern test_func test_smfs_starve_0;
 extern test_func test_smfs_starve_1;
 extern test_func test_smfs_starve_2;
@@ -0,0 +1,45 @@
+/* Creates many short-lived threads, one after another, and
+   reports the average latency of thread_create() itself and of a
+   whole create, run, and exit round trip.  After the first few,
+   each thread should reuse the page of a thread that died
+   before it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "devices/timer.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 1000
+
+static thread_func done_thread_func;
+
+void test_thread_create_bench(void) {
+  struct semaphore done;
+  int64_t create_ns = 0;
+  int64_t start, total_ns;
+  int i;
+
+  sema_init(&done, 0);
+  start = timer_ns();
+  for (i = 0; i < THREAD_CNT; i++) {
+    int64_t before = timer_ns();
+    tid_t tid = thread_create("bench", PRI_DEFAULT, done_thread_func, &done);
+    create_ns += timer_ns() - before;
+    if (tid == TID_ERROR)
+      fail("thread_create failed after %d threads", i);
+    sema_down(&done);
+  }
+  total_ns = timer_ns() - start;
+
+  msg("created %d threads", THREAD_CNT);
+  msg("thread_create: %lld ns per thread", create_ns / THREAD_CNT);
+  msg("create, run, and exit: %lld ns per thread", total_ns / THREAD_CNT);
+}
+
+static void done_thread_func(void* done_) {
+  struct semaphore* done = done_;
+
+  sema_up(done);
+}
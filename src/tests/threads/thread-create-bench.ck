@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# Almost every thread should have reused the page of the thread
+# that exited just before it.  The kernel's statistics, printed at
+# power off, count how many did.
+my ($recycled) = map (/^Thread: (\d+) created on recycled pages$/, @output);
+fail "missing thread page statistics in output" if !defined $recycled;
+fail "only $recycled of 1000 threads reused a thread page" if $recycled < 900;
+
+# The timings vary from run to run.
+s/^(\(thread-create-bench\) .*:) \d+ (ns per thread)$/$1 N $2/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(thread-create-bench) begin
+(thread-create-bench) created 1000 threads
+(thread-create-bench) thread_create: N ns per thread
+(thread-create-bench) create, run, and exit: N ns per thread
+(thread-create-bench) end
+EOF
+pass;
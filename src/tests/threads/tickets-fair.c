@@ -0,0 +1,76 @@
+/* Checks that the stride and lottery schedulers divide the CPU
+   in proportion to tickets.
+
+   Three threads holding 100, 200, and 300 tickets spin for 10
+   seconds, counting the timer ticks they see while running.
+   They should receive about 1/6, 2/6, and 3/6 of the ticks, that
+   is, about 167, 333, and 500 ticks at 100 Hz.  The stride
+   scheduler hits these shares almost exactly; the lottery
+   scheduler only on average. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 3
+
+struct thread_info {
+  int64_t start_time;
+  int tick_count;
+  int tickets;
+};
+
+static void test_tickets(enum sched_policy);
+static void load_thread(void* aux);
+
+void test_stride_fair(void) { test_tickets(SCHED_STRIDE); }
+
+void test_lottery_fair(void) { test_tickets(SCHED_LOTTERY); }
+
+static void test_tickets(enum sched_policy policy) {
+  struct thread_info info[THREAD_CNT];
+  int64_t start_time;
+  int i;
+
+  ASSERT(active_sched_policy == policy);
+
+  start_time = timer_ticks();
+  msg("Starting %d threads...", THREAD_CNT);
+  for (i = 0; i < THREAD_CNT; i++) {
+    struct thread_info* ti = &info[i];
+    char name[16];
+
+    ti->start_time = start_time;
+    ti->tick_count = 0;
+    ti->tickets = (i + 1) * TICKETS_DEFAULT;
+
+    snprintf(name, sizeof name, "load %d", i);
+    thread_create(name, PRI_DEFAULT, load_thread, ti);
+  }
+
+  msg("Sleeping 12 seconds to let threads run, please wait...");
+  timer_sleep(12 * TIMER_FREQ);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    msg("Thread %d with %d tickets received %d ticks.", i, info[i].tickets, info[i].tick_count);
+}
+
+static void load_thread(void* ti_) {
+  struct thread_info* ti = ti_;
+  int64_t sleep_time = 1 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + 10 * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  thread_set_tickets(ti->tickets);
+  timer_sleep(sleep_time - timer_elapsed(ti->start_time));
+  while (timer_elapsed(ti->start_time) < spin_time) {
+    int64_t cur_time = timer_ticks();
+    if (cur_time != last_time)
+      ti->tick_count++;
+    last_time = cur_time;
+  }
+}
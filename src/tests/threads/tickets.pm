@@ -0,0 +1,38 @@
+# -*- perl -*-
+use strict;
+use warnings;
+
+# Checks the output of a tickets-fair test.  Each thread's share
+# of the ticks should match its share of the tickets to within
+# TOLERANCE, a fraction of all the ticks.
+sub check_tickets_fair {
+    my ($tolerance) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    my (@tickets, @ticks);
+    my ($total_tickets, $total_ticks) = (0, 0);
+    local ($_);
+    foreach (@output) {
+	my ($id, $tickets, $count)
+	  = /Thread (\d+) with (\d+) tickets received (\d+) ticks\./ or next;
+	$tickets[$id] = $tickets;
+	$ticks[$id] = $count;
+	$total_tickets += $tickets;
+	$total_ticks += $count;
+    }
+    fail "expected 3 threads, got " . scalar (@ticks) . "\n" if @ticks != 3;
+    fail "threads received no ticks\n" if $total_ticks == 0;
+
+    for my $id (0...$#ticks) {
+	my ($expected) = $total_ticks * $tickets[$id] / $total_tickets;
+	fail sprintf ("thread %d received %d ticks, expected about %d\n",
+		      $id, $ticks[$id], $expected)
+	  if abs ($ticks[$id] - $expected) > $total_ticks * $tolerance;
+    }
+    pass;
+}
+
+1;
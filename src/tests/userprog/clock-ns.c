@@ -0,0 +1,30 @@
+/* Reads the nanosecond clock with clock_ns() and checks that it
+   never goes backward and that it keeps advancing. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define READS 10000
+
+void test_main(void) {
+  int64_t start = clock_ns();
+  int64_t prev = start;
+  int64_t now;
+  int i;
+
+  CHECK(start > 0, "clock_ns() is positive");
+  msg("read clock %d times", READS);
+  for (i = 0; i < READS; i++) {
+    now = clock_ns();
+    if (now < prev)
+      fail("clock went backward from %lld to %lld ns", prev, now);
+    prev = now;
+  }
+
+  /* Spin for 20 ms, two timer ticks at 100 Hz. */
+  msg("spin until 20 ms have passed");
+  while (clock_ns() - start < 20 * 1000 * 1000)
+    continue;
+}
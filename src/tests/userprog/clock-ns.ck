@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(clock-ns) begin
+(clock-ns) clock_ns() is positive
+(clock-ns) read clock 10000 times
+(clock-ns) spin until 20 ms have passed
+(clock-ns) end
+clock-ns: exit(0)
+EOF
+pass;
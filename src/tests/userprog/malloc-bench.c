@@ -0,0 +1,57 @@
+/* Measures the throughput of malloc() and free() on a mix of
+   small and large blocks, checking along the way that no two
+   live blocks overlap. */
+
+#include <malloc.h>
+#include <stdint.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUNDS 50
+#define SLOTS 256
+
+static char* blocks[SLOTS];
+
+/* Returns the size of the block in slot I: mostly up to 1 kB,
+   with a few large ones. */
+static size_t slot_size(int i) { return i % 32 == 31 ? 16384 + i * 64 : 1 + (i * 37) % 1024; }
+
+/* Returns the CPU's time-stamp counter. */
+static uint64_t rdtsc(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+void test_main(void) {
+  uint64_t start, cycles;
+  int round, i;
+
+  start = rdtsc();
+  for (round = 0; round < ROUNDS; round++) {
+    for (i = 0; i < SLOTS; i++) {
+      blocks[i] = malloc(slot_size(i));
+      if (blocks[i] == NULL)
+        fail("malloc(%zu) failed in round %d", slot_size(i), round);
+      blocks[i][0] = blocks[i][slot_size(i) - 1] = i;
+    }
+
+    /* Free every other block first, so that later rounds reuse
+       blocks in a different order. */
+    for (i = round % 2; i < SLOTS; i += 2) {
+      if (blocks[i][0] != (char)i || blocks[i][slot_size(i) - 1] != (char)i)
+        fail("block %d overwritten in round %d", i, round);
+      free(blocks[i]);
+    }
+    for (i = 1 - round % 2; i < SLOTS; i += 2) {
+      if (blocks[i][0] != (char)i || blocks[i][slot_size(i) - 1] != (char)i)
+        fail("block %d overwritten in round %d", i, round);
+      free(blocks[i]);
+    }
+  }
+  cycles = rdtsc() - start;
+
+  msg("%d malloc/free pairs", ROUNDS * SLOTS);
+  msg("%d cycles per pair", (int)(cycles / (ROUNDS * SLOTS)));
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# The cycle count varies from run to run.
+s/^(\(malloc-bench\)) \d+ (cycles per pair)$/$1 N $2/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(malloc-bench) begin
+(malloc-bench) 12800 malloc/free pairs
+(malloc-bench) N cycles per pair
+(malloc-bench) end
+malloc-bench: exit(0)
+EOF
+pass;
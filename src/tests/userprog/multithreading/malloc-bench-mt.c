@@ -0,0 +1,67 @@
+/* Measures the throughput of malloc() and free() with several
+   threads allocating from the same size classes at once, and
+   checks that no two live blocks overlap. */
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define NUM_THREADS 4
+#define ROUNDS 50
+#define SLOTS 128
+
+static char* blocks[NUM_THREADS][SLOTS];
+
+/* Returns the size of the block in slot I. */
+static size_t slot_size(int i) { return 1 + (i * 37) % 512; }
+
+/* Returns the CPU's time-stamp counter. */
+static uint64_t rdtsc(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+/* Allocates and frees blocks in thread *ARG_'s row of BLOCKS,
+   tagging each block with the thread and slot it belongs to. */
+static void thread_function(void* arg_) {
+  int id = *(int*)arg_;
+  char** row = blocks[id];
+  int round, i;
+
+  for (round = 0; round < ROUNDS; round++) {
+    for (i = 0; i < SLOTS; i++) {
+      row[i] = malloc(slot_size(i));
+      if (row[i] == NULL)
+        fail("thread %d: malloc(%zu) failed", id, slot_size(i));
+      row[i][0] = row[i][slot_size(i) - 1] = id * SLOTS + i;
+    }
+    for (i = 0; i < SLOTS; i++) {
+      char tag = id * SLOTS + i;
+      if (row[i][0] != tag || row[i][slot_size(i) - 1] != tag)
+        fail("thread %d: block %d overwritten", id, i);
+      free(row[i]);
+    }
+  }
+}
+
+void test_main(void) {
+  int ids[NUM_THREADS];
+  tid_t tids[NUM_THREADS];
+  uint64_t start, cycles;
+  int i;
+
+  start = rdtsc();
+  for (i = 0; i < NUM_THREADS; i++) {
+    ids[i] = i;
+    tids[i] = pthread_check_create(thread_function, &ids[i]);
+  }
+  for (i = 0; i < NUM_THREADS; i++)
+    pthread_check_join(tids[i]);
+  cycles = rdtsc() - start;
+
+  msg("%d malloc/free pairs in %d threads", NUM_THREADS * ROUNDS * SLOTS, NUM_THREADS);
+  msg("%d cycles per pair", (int)(cycles / (NUM_THREADS * ROUNDS * SLOTS)));
+}
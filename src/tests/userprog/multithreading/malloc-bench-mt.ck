@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# The cycle count varies from run to run.
+s/^(\(malloc-bench-mt\)) \d+ (cycles per pair)$/$1 N $2/ foreach @output;
+compare_output ("run", IGNORE_USER_FAULTS => 1, \@output, [<<'EOF']);
+(malloc-bench-mt) begin
+(malloc-bench-mt) 25600 malloc/free pairs in 4 threads
+(malloc-bench-mt) N cycles per pair
+(malloc-bench-mt) end
+malloc-bench-mt: exit(0)
+EOF
+pass;
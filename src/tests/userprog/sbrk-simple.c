@@ -0,0 +1,50 @@
+/* Grows the heap with sbrk(), writes every byte of it, shrinks
+   it again, and checks that the heap cannot shrink below where
+   it started or grow into the space reserved for stacks.  Heap
+   pages are only allocated when they are touched, so the heap
+   can grow right up to that limit however little memory the
+   machine has. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PGSIZE 4096
+
+/* The heap may grow up to the MAX_STACK_PAGES pages below
+   PHYS_BASE that are reserved for the stacks. */
+#define HEAP_LIMIT ((char*)0xc0000000 - (1 << 11) * PGSIZE)
+
+/* Step in which the heap is grown toward its limit. */
+#define STEP (16 * 1024 * 1024)
+
+void test_main(void) {
+  char* start = sbrk(0);
+  char* p;
+  char* end;
+
+  CHECK(start != SBRK_FAILED, "sbrk(0)");
+  CHECK(sbrk(3 * PGSIZE + 100) == start, "grow heap by 3 pages and 100 bytes");
+  memset(start, 0x5a, 3 * PGSIZE + 100);
+  for (p = start; p < start + 3 * PGSIZE + 100; p++)
+    if (*p != 0x5a)
+      fail("byte %d is %02x, not 5a", (int)(p - start), *p);
+  CHECK(sbrk(0) == start + 3 * PGSIZE + 100, "break is at end of heap");
+  CHECK(sbrk(-2 * PGSIZE) == start + 3 * PGSIZE + 100, "shrink heap by 2 pages");
+  CHECK(start[PGSIZE + 99] == 0x5a, "heap below break kept its data");
+  CHECK(sbrk(-2 * PGSIZE) == SBRK_FAILED, "shrink below start of heap");
+
+  while (sbrk(STEP) != SBRK_FAILED)
+    continue;
+  end = sbrk(0);
+  CHECK(end <= HEAP_LIMIT && end + STEP > HEAP_LIMIT, "grow heap in steps until it fails");
+  CHECK(sbrk(HEAP_LIMIT - end) == end, "grow heap to its limit");
+  CHECK(sbrk(1) == SBRK_FAILED, "grow heap past its limit");
+  HEAP_LIMIT[-1] = 0x5a;
+  CHECK(HEAP_LIMIT[-1] == 0x5a && HEAP_LIMIT[-PGSIZE - 1] == 0, "touch top of heap");
+  CHECK(start[PGSIZE + 99] == 0x5a, "bottom of heap kept its data");
+  CHECK(brk(start), "brk back to start of heap");
+  CHECK(sbrk(0) == start, "break is at start of heap");
+}
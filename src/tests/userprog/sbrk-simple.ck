@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(sbrk-simple) begin
+(sbrk-simple) sbrk(0)
+(sbrk-simple) grow heap by 3 pages and 100 bytes
+(sbrk-simple) break is at end of heap
+(sbrk-simple) shrink heap by 2 pages
+(sbrk-simple) heap below break kept its data
+(sbrk-simple) shrink below start of heap
+(sbrk-simple) grow heap in steps until it fails
+(sbrk-simple) grow heap to its limit
+(sbrk-simple) grow heap past its limit
+(sbrk-simple) touch top of heap
+(sbrk-simple) bottom of heap kept its data
+(sbrk-simple) brk back to start of heap
+(sbrk-simple) break is at start of heap
+(sbrk-simple) end
+sbrk-simple: exit(0)
+EOF
+pass;
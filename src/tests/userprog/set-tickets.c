@@ -0,0 +1,16 @@
+/* Sets the scheduling tickets of the current thread with
+   set_tickets(), which accepts 1 to 10000 tickets and rejects
+   any other count. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void) {
+  CHECK(set_tickets(1), "set_tickets(1)");
+  CHECK(set_tickets(100), "set_tickets(100)");
+  CHECK(set_tickets(10000), "set_tickets(10000)");
+  CHECK(!set_tickets(0), "set_tickets(0) fails");
+  CHECK(!set_tickets(-1), "set_tickets(-1) fails");
+  CHECK(!set_tickets(10001), "set_tickets(10001) fails");
+}
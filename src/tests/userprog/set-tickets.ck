@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(set-tickets) begin
+(set-tickets) set_tickets(1)
+(set-tickets) set_tickets(100)
+(set-tickets) set_tickets(10000)
+(set-tickets) set_tickets(0) fails
+(set-tickets) set_tickets(-1) fails
+(set-tickets) set_tickets(10001) fails
+(set-tickets) end
+set-tickets: exit(0)
+EOF
+pass;
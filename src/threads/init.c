@@ -34,6 +34,11 @@
 #ifdef THREADS
 #include "tests/threads/tests.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
@@ -44,6 +49,11 @@
 /* Page directory with kernel mappings only. */
 uint32_t* init_page_dir;
 
+/* 4 MB page support: the CPUID feature flag (in EDX of leaf 1)
+   that reports it, and the CR4 bit that enables it. */
+#define CPUID_PSE 0x00000008
+#define CR4_PSE 0x00000010
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -60,8 +70,31 @@ static const char* swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -arena-retain: Number of empty arenas each malloc() size class
+   keeps before returning pages to the page allocator. */
+static size_t arena_retain = 2;
+
+/* -tickless: Stop the timer tick while the CPU is idle? */
+static bool tickless_idle;
+
+/* -slice-min, -slice-max: Bounds on adaptive round-robin time
+   slices, in timer ticks. */
+static int slice_min = 1;
+static int slice_max = 16;
+
+#ifdef VM
+/* -fault-around: Size of the window of resident pages mapped
+   around each page fault, in pages. */
+static size_t fault_around_pages = 16;
+
+/* -rss-limit: Soft limit on each process's resident set, in
+   pages, or 0 for none. */
+static size_t rss_limit;
+#endif
+
 static void bss_init(void);
 static void paging_init(void);
+static bool cpu_has_pse(void);
 
 static char** read_command_line(void);
 static char** parse_options(char** argv);
@@ -86,7 +119,7 @@ int main(void) {
 
   /* Initialize ourselves as a thread so we can use locks,
      then enable console locking. */
-  thread_init();
+  thread_init(slice_min, slice_max);
   console_init();
 
   /* Greet user. */
@@ -94,8 +127,12 @@ int main(void) {
 
   /* Initialize memory system. */
   palloc_init(user_page_limit);
-  malloc_init();
+  malloc_init(arena_retain);
   paging_init();
+#ifdef VM
+  frame_init();
+  page_init(fault_around_pages, rss_limit);
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -105,7 +142,7 @@ int main(void) {
 
   /* Initialize interrupt handlers. */
   intr_init();
-  timer_init();
+  timer_init(tickless_idle);
   kbd_init();
   input_init();
 #ifdef USERPROG
@@ -130,6 +167,12 @@ int main(void) {
   filesys_init(format_filesys);
 #endif
 
+#ifdef VM
+  /* Start paging out. */
+  swap_init();
+  frame_scan_start();
+#endif
+
   printf("Boot complete.\n");
 
   /* Run actions specified on kernel command line. */
@@ -159,6 +202,15 @@ static void paging_init(void) {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  bool pse = cpu_has_pse();
+
+  if (pse) {
+    /* Enable 4 MB pages.  See [IA32-v3a] 2.5 "Control
+       Registers". */
+    uint32_t cr4;
+    asm volatile("movl %%cr4, %0" : "=r"(cr4));
+    asm volatile("movl %0, %%cr4" : : "r"(cr4 | CR4_PSE));
+  }
 
   pd = init_page_dir = palloc_get_page(PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -169,6 +221,18 @@ static void paging_init(void) {
     size_t pte_idx = pt_no(vaddr);
     bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+    /* Map each 4 MB of RAM that lies entirely within memory and
+       holds no kernel text with a single large page, sparing a
+       page table and most of the TLB entries for it.  The
+       kernel text stays in 4 kB pages so that it can remain
+       write-protected. */
+    if (pse && pte_idx == 0 && page + PTSPAN / PGSIZE <= init_ram_pages &&
+        !(vaddr < &_end_kernel_text && &_start < vaddr + PTSPAN)) {
+      pd[pde_idx] = pde_create_large(vaddr, true);
+      page += PTSPAN / PGSIZE - 1;
+      continue;
+    }
+
     if (pd[pde_idx] == 0) {
       pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
       pd[pde_idx] = pde_create(pt);
@@ -185,6 +249,15 @@ static void paging_init(void) {
   asm volatile("movl %0, %%cr3" : : "r"(vtop(init_page_dir)));
 }
 
+/* Returns true if the CPU supports 4 MB pages, according to the
+   PSE feature flag reported by CPUID.  See [IA32-v2a]
+   "CPUID--CPU Identification". */
+static bool cpu_has_pse(void) {
+  uint32_t eax = 1, ebx, ecx, edx;
+  asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+  return (edx & CPUID_PSE) != 0;
+}
+
 /* Breaks the kernel command line into words and returns them as
    an argv-like array. */
 static char** read_command_line(void) {
@@ -247,6 +320,14 @@ static char** parse_options(char** argv) {
 #endif
     else if (!strcmp(name, "-rs"))
       random_init(atoi(value));
+    else if (!strcmp(name, "-arena-retain"))
+      arena_retain = atoi(value);
+    else if (!strcmp(name, "-tickless"))
+      tickless_idle = true;
+    else if (!strcmp(name, "-slice-min"))
+      slice_min = atoi(value);
+    else if (!strcmp(name, "-slice-max"))
+      slice_max = atoi(value);
     else if (!strcmp(name, "-sched")) {
       if (!strcmp(value, "fifo"))
         scheduler_flags[SCHED_FIFO] = 1;
@@ -256,20 +337,35 @@ static char** parse_options(char** argv) {
         scheduler_flags[SCHED_FAIR] = 1;
       else if (!strcmp(value, "mlfqs"))
         scheduler_flags[SCHED_MLFQS] = 1;
+      else if (!strcmp(value, "stride"))
+        scheduler_flags[SCHED_STRIDE] = 1;
+      else if (!strcmp(value, "lottery"))
+        scheduler_flags[SCHED_LOTTERY] = 1;
+      else if (!strcmp(value, "edf"))
+        scheduler_flags[SCHED_EDF] = 1;
       else
         PANIC("unknown scheduler option `%s' (use -h for help)", value);
     }
 #ifdef USERPROG
     else if (!strcmp(name, "-ul"))
       user_page_limit = atoi(value);
+#endif
+#ifdef VM
+    else if (!strcmp(name, "-fault-around"))
+      fault_around_pages = atoi(value);
+    else if (!strcmp(name, "-rss-limit"))
+      rss_limit = atoi(value);
 #endif
     else
       PANIC("unknown option `%s' (use -h for help)", name);
   }
 
+  if (slice_min < 1 || slice_max < slice_min)
+    PANIC("bad time slice bounds %d..%d (use -h for help)", slice_min, slice_max);
+
   /* Configure the kernel scheduler to use the algorithm
    * corresponding to the requested command-line options.
-   * All three flags are mutually-exclusive, and as such
+   * All of these flags are mutually-exclusive, and as such
    * setting multiple will panic.
    * If none are set, the scheduler is set to use the
    * default value, SCHED_PRIO. */
@@ -280,8 +376,9 @@ static char** parse_options(char** argv) {
   if (sched_flags_set == 0)
     active_sched_policy = SCHED_DEFAULT;
   else if (sched_flags_set > 1)
-    PANIC("too many scheduler flags set: set at most one of \"-sched-fifo\", \"-sched-prio\", "
-          "\"-sched-fair\", \"-sched-mlfqs\"");
+    PANIC("too many scheduler flags set: set at most one of \"-sched=fifo\", \"-sched=prio\", "
+          "\"-sched=fair\", \"-sched=mlfqs\", \"-sched=stride\", \"-sched=lottery\", "
+          "\"-sched=edf\"");
   else if (scheduler_flags[SCHED_FIFO])
     active_sched_policy = SCHED_FIFO;
   else if (scheduler_flags[SCHED_PRIO])
@@ -290,6 +387,12 @@ static char** parse_options(char** argv) {
     active_sched_policy = SCHED_FAIR;
   else if (scheduler_flags[SCHED_MLFQS])
     active_sched_policy = SCHED_MLFQS;
+  else if (scheduler_flags[SCHED_STRIDE])
+    active_sched_policy = SCHED_STRIDE;
+  else if (scheduler_flags[SCHED_LOTTERY])
+    active_sched_policy = SCHED_LOTTERY;
+  else if (scheduler_flags[SCHED_EDF])
+    active_sched_policy = SCHED_EDF;
   else
     PANIC("kernel bug in init.c: unreachable case");
 
@@ -425,15 +528,24 @@ static void usage(void) {
 #endif // VM
 #endif // FILESYS
          "  -rs=SEED           Set random number seed to SEED.\n"
-         "  -sched-fair        Use alternate non-strict priority scheduler. Mutually exclusive "
-         "with \"-sched-mlfqs\", \"-sched-prio\".\n"
-         "  -sched-mlfqs       Use multi-level feedback queue scheduler. Mutually exclusive with "
-         "\"-sched-fair\", \"-sched-prio\".\n"
-         "  -sched-prio        Use strict-priority round-robin scheduler. Mutually exclusive with "
-         "\"-sched-fair\", \"-sched-mlfqs\".\n"
+         "  -arena-retain=N    Keep up to N empty malloc arenas per size class.\n"
+         "  -tickless          Stop the timer tick while the CPU is idle.\n"
+         "  -slice-min=N       Give I/O-bound threads time slices down to N ticks.\n"
+         "  -slice-max=N       Give CPU-bound threads time slices up to N ticks.\n"
+         "  -sched=fifo        Use first-in, first-out scheduler (the default).\n"
+         "  -sched=prio        Use strict-priority round-robin scheduler.\n"
+         "  -sched=fair        Use alternate non-strict priority scheduler.\n"
+         "  -sched=mlfqs       Use multi-level feedback queue scheduler.\n"
+         "  -sched=stride      Use proportional-share stride scheduler.\n"
+         "  -sched=lottery     Use proportional-share lottery scheduler.\n"
+         "  -sched=edf         Use earliest-deadline-first for real-time threads.\n"
 #ifdef USERPROG
          "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif // USERPROG
+#ifdef VM
+         "  -fault-around=N    Map up to N resident pages around each page fault.\n"
+         "  -rss-limit=COUNT   Prefer evicting from processes with over COUNT resident pages.\n"
+#endif // VM
   );
   shutdown_power_off();
 }
@@ -196,6 +196,27 @@ void intr_register_int(uint8_t vec_no, int dpl, enum intr_level level, intr_hand
    and false at all other times. */
 bool intr_context(void) { return in_external_intr; }
 
+/* Returns true if external interrupt VEC_NO has been raised but
+   not yet delivered to the CPU, because interrupts are off or a
+   higher-priority interrupt is in service. */
+bool intr_is_pending(uint8_t vec_no) {
+  enum intr_level old_level;
+  int irq = vec_no - 0x20;
+  int port = irq < 8 ? PIC0_CTRL : PIC1_CTRL;
+  bool pending;
+
+  ASSERT(vec_no >= 0x20 && vec_no <= 0x2f);
+
+  /* OCW3: the next read of the control port returns the
+     Interrupt Request Register. */
+  old_level = intr_disable();
+  outb(port, 0x0a);
+  pending = (inb(port) & (1 << (irq & 7))) != 0;
+  intr_set_level(old_level);
+
+  return pending;
+}
+
 /* During processing of an external interrupt, directs the
    interrupt handler to yield to a new process just before
    returning from the interrupt.  May not be called at any other
@@ -11,35 +11,66 @@
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
+   The size of each request, in bytes, is rounded up to the next
+   size class and assigned to the "descriptor" that manages
+   blocks of that size.  There are four size classes between
+   each pair of powers of 2 from 16 bytes to MAX_BLOCK bytes (16,
+   20, 24, 28, 32, 40, 48, ...), so no more than about 20% of a
+   block is wasted on rounding.  The descriptor keeps a list of
+   free blocks.  If the free list is nonempty, one of its blocks
+   is used to satisfy the request.
+
+   Otherwise, a new "arena" of one or more pages is obtained
+   from the page allocator (if none is available, malloc()
+   returns a null pointer).  Each descriptor uses the smallest
+   arena that leaves at most an eighth of it unused, so that
+   medium blocks of a few kB pack several to an arena instead of
+   each taking whole pages.  The new arena is divided into
+   blocks, all of which are added to the descriptor's free list.
+   Then we return one of the new blocks.
+
+   A block in a one-page arena finds its arena header by rounding
+   down to the page boundary.  Multi-page arenas are registered
+   as page groups with the page allocator, which can map any of
+   their pages back to the first one.
 
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   and give the arena back to the page allocator.  Each
+   descriptor keeps up to a few such empty arenas around instead,
+   so that a size class that repeatedly allocates and frees a
+   single block does not take and return a page every time.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   Blocks bigger than MAX_BLOCK are handled by allocating
+   contiguous pages with the page allocator and sticking the
+   allocation size at the beginning of the allocated block's
+   arena header. */
+
+/* Largest block size handled by a descriptor. */
+#define MAX_BLOCK (16 * 1024)
+
+/* Number of descriptors: one for 16 bytes, plus four for each
+   doubling up to MAX_BLOCK. */
+#define DESC_CNT 41
+
+/* Maximum number of pages in an arena. */
+#define MAX_ARENA_PAGES 16
 
 /* Descriptor. */
 struct desc {
   size_t block_size;       /* Size of each element in bytes. */
+  size_t arena_pages;      /* Number of pages in an arena. */
   size_t blocks_per_arena; /* Number of blocks in an arena. */
   struct list free_list;   /* List of free blocks. */
   struct lock lock;        /* Lock. */
+  size_t empty_cnt;        /* Arenas with no blocks in use. */
+
+  /* Statistics, protected by LOCK. */
+  size_t arena_cnt;        /* Arenas currently allocated. */
+  long long release_cnt;   /* Total arenas given back to palloc. */
+  long long alloc_cnt;     /* Total blocks allocated. */
+  long long requested;     /* Total bytes requested in those blocks. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -57,25 +88,56 @@ struct block {
   struct list_elem free_elem; /* Free list element. */
 };
 
-/* Our set of descriptors. */
-static struct desc descs[10]; /* Descriptors. */
-static size_t desc_cnt;       /* Number of descriptors. */
+/* Our set of descriptors, in order of block size. */
+static struct desc descs[DESC_CNT];
 
+/* Maximum number of empty arenas kept by each descriptor. */
+static size_t arena_retain;
+
+/* Big block statistics. */
+static struct lock big_lock;       /* Protects the following. */
+static long long big_cnt;          /* Total big blocks allocated. */
+static long long big_requested;    /* Total bytes requested in them. */
+static long long big_pages;        /* Total pages they took. */
+
+static struct desc* size_to_desc(size_t size);
+static bool resize_in_place(void* block, size_t new_size);
 static struct arena* block_to_arena(struct block*);
 static struct block* arena_to_block(struct arena*, size_t idx);
 
-/* Initializes the malloc() descriptors. */
-void malloc_init(void) {
-  size_t block_size;
+/* Initializes the malloc() descriptors.  Each descriptor keeps
+   up to RETAIN arenas with no blocks in use before giving pages
+   back to the page allocator. */
+void malloc_init(size_t retain) {
+  size_t i;
+
+  arena_retain = retain;
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
-    struct desc* d = &descs[desc_cnt++];
-    ASSERT(desc_cnt <= sizeof descs / sizeof *descs);
-    d->block_size = block_size;
-    d->blocks_per_arena = (PGSIZE - sizeof(struct arena)) / block_size;
+  for (i = 0; i < DESC_CNT; i++) {
+    struct desc* d = &descs[i];
+    size_t base = 16 << (i == 0 ? 0 : (i - 1) / 4);
+
+    d->block_size = i == 0 ? 16 : base + base / 4 * ((i - 1) % 4 + 1);
+
+    /* Use the smallest arena that wastes no more than 1/8 of
+       its space. */
+    for (d->arena_pages = 1; d->arena_pages < MAX_ARENA_PAGES; d->arena_pages++) {
+      size_t space = d->arena_pages * PGSIZE - sizeof(struct arena);
+      if (space >= d->block_size && space % d->block_size <= d->arena_pages * PGSIZE / 8)
+        break;
+    }
+    d->blocks_per_arena = (d->arena_pages * PGSIZE - sizeof(struct arena)) / d->block_size;
+    ASSERT(d->blocks_per_arena > 0);
     list_init(&d->free_list);
     lock_init(&d->lock);
+    d->empty_cnt = 0;
+    d->arena_cnt = 0;
+    d->release_cnt = 0;
+    d->alloc_cnt = 0;
+    d->requested = 0;
   }
+  ASSERT(descs[DESC_CNT - 1].block_size == MAX_BLOCK);
+  lock_init(&big_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -91,10 +153,8 @@ void* malloc(size_t size) {
 
   /* Find the smallest descriptor that satisfies a SIZE-byte
      request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) {
+  d = size_to_desc(size);
+  if (d == NULL) {
     /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
     size_t page_cnt = DIV_ROUND_UP(size + sizeof *a, PGSIZE);
@@ -102,6 +162,12 @@ void* malloc(size_t size) {
     if (a == NULL)
       return NULL;
 
+    lock_acquire(&big_lock);
+    big_cnt++;
+    big_requested += size;
+    big_pages += page_cnt;
+    lock_release(&big_lock);
+
     /* Initialize the arena to indicate a big block of PAGE_CNT
          pages, and return it. */
     a->magic = ARENA_MAGIC;
@@ -116,12 +182,16 @@ void* malloc(size_t size) {
   if (list_empty(&d->free_list)) {
     size_t i;
 
-    /* Allocate a page. */
-    a = palloc_get_page(0);
+    /* Allocate pages. */
+    a = palloc_get_multiple(0, d->arena_pages);
     if (a == NULL) {
       lock_release(&d->lock);
       return NULL;
     }
+    if (d->arena_pages > 1)
+      palloc_set_group(a, d->arena_pages);
+    d->arena_cnt++;
+    d->empty_cnt++;
 
     /* Initialize arena and add its blocks to the free list. */
     a->magic = ARENA_MAGIC;
@@ -136,7 +206,10 @@ void* malloc(size_t size) {
   /* Get a block from free list and return it. */
   b = list_entry(list_pop_front(&d->free_list), struct block, free_elem);
   a = block_to_arena(b);
-  a->free_cnt--;
+  if (a->free_cnt-- == d->blocks_per_arena)
+    d->empty_cnt--;
+  d->alloc_cnt++;
+  d->requested += size;
   lock_release(&d->lock);
   return b;
 }
@@ -169,6 +242,32 @@ static size_t block_size(void* block) {
   return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs(block);
 }
 
+/* Tries to resize BLOCK to NEW_SIZE bytes without moving it and
+   returns true if successful.  A block from a descriptor keeps
+   its place if NEW_SIZE still fits, unless it would fit in a
+   block half the size or less.  A big block gives back the pages
+   it no longer needs, or takes the pages that follow it if they
+   are free. */
+static bool resize_in_place(void* block, size_t new_size) {
+  struct arena* a = block_to_arena(block);
+  struct desc* d = a->desc;
+
+  if (d != NULL)
+    return new_size <= d->block_size && size_to_desc(new_size)->block_size > d->block_size / 2;
+  else {
+    size_t page_cnt = DIV_ROUND_UP(new_size + sizeof *a, PGSIZE);
+
+    if (new_size <= MAX_BLOCK)
+      return false;
+    if (page_cnt < a->free_cnt)
+      palloc_free_multiple((uint8_t*)a + page_cnt * PGSIZE, a->free_cnt - page_cnt);
+    else if (page_cnt > a->free_cnt && !palloc_extend(a, a->free_cnt, page_cnt))
+      return false;
+    a->free_cnt = page_cnt;
+    return true;
+  }
+}
+
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
    moving it in the process.
    If successful, returns the new block; on failure, returns a
@@ -179,6 +278,8 @@ void* realloc(void* old_block, size_t new_size) {
   if (new_size == 0) {
     free(old_block);
     return NULL;
+  } else if (old_block != NULL && resize_in_place(old_block, new_size)) {
+    return old_block;
   } else {
     void* new_block = malloc(new_size);
     if (old_block != NULL && new_block != NULL) {
@@ -212,16 +313,24 @@ void free(void* p) {
       /* Add block to free list. */
       list_push_front(&d->free_list, &b->free_elem);
 
-      /* If the arena is now entirely unused, free it. */
+      /* If the arena is now entirely unused, free it, unless
+         we are still keeping fewer than ARENA_RETAIN empty
+         arenas. */
       if (++a->free_cnt >= d->blocks_per_arena) {
-        size_t i;
-
         ASSERT(a->free_cnt == d->blocks_per_arena);
-        for (i = 0; i < d->blocks_per_arena; i++) {
-          struct block* b = arena_to_block(a, i);
-          list_remove(&b->free_elem);
+        if (d->empty_cnt < arena_retain)
+          d->empty_cnt++;
+        else {
+          size_t i;
+
+          for (i = 0; i < d->blocks_per_arena; i++) {
+            struct block* b = arena_to_block(a, i);
+            list_remove(&b->free_elem);
+          }
+          palloc_free_multiple(a, d->arena_pages);
+          d->arena_cnt--;
+          d->release_cnt++;
         }
-        palloc_free_page(a);
       }
 
       lock_release(&d->lock);
@@ -233,16 +342,66 @@ void free(void* p) {
   }
 }
 
+/* Prints statistics on how much of the memory taken by blocks
+   was actually requested. */
+void malloc_print_stats(void) {
+  long long requested = big_requested;
+  long long reserved = big_pages * PGSIZE;
+  long long arena_pages = 0;
+  long long empty_pages = 0;
+  long long released = 0;
+  size_t i;
+
+  for (i = 0; i < DESC_CNT; i++) {
+    struct desc* d = &descs[i];
+    requested += d->requested;
+    reserved += d->alloc_cnt * d->block_size;
+    arena_pages += d->arena_cnt * d->arena_pages;
+    empty_pages += d->empty_cnt * d->arena_pages;
+    released += d->release_cnt;
+  }
+  printf("Malloc: %lld bytes requested, %lld bytes reserved (%lld%% wasted), "
+         "%lld pages in arenas (%lld empty), %lld arenas released\n",
+         requested, reserved, reserved > 0 ? (reserved - requested) * 100 / reserved : 0,
+         arena_pages, empty_pages, released);
+}
+
+/* Returns the descriptor for the smallest size class that holds
+   SIZE bytes, or a null pointer if SIZE exceeds MAX_BLOCK. */
+static struct desc* size_to_desc(size_t size) {
+  size_t base = 16;
+  size_t i = 0;
+
+  if (size <= 16)
+    return &descs[0];
+  if (size > MAX_BLOCK)
+    return NULL;
+
+  /* Find the power of 2 just below SIZE, then the quarter step
+     above it. */
+  while (base * 2 < size) {
+    base *= 2;
+    i += 4;
+  }
+  return &descs[i + DIV_ROUND_UP(size - base, base / 4)];
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena* block_to_arena(struct block* b) {
-  struct arena* a = pg_round_down(b);
+  struct arena* a = palloc_group_head(b);
+
+  /* Blocks in one-page arenas and big blocks are in the arena's
+     first page. */
+  if (a == NULL)
+    a = pg_round_down(b);
 
   /* Check that the arena is valid. */
   ASSERT(a != NULL);
   ASSERT(a->magic == ARENA_MAGIC);
 
   /* Check that the block is properly aligned for the arena. */
-  ASSERT(a->desc == NULL || (pg_ofs(b) - sizeof *a) % a->desc->block_size == 0);
+  ASSERT(a->desc == NULL ||
+         ((uint8_t*)b - (uint8_t*)(a + 1)) % a->desc->block_size == 0);
   ASSERT(a->desc != NULL || pg_ofs(b) == sizeof *a);
 
   return a;
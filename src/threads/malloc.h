@@ -4,10 +4,11 @@
 #include <debug.h>
 #include <stddef.h>
 
-void malloc_init(void);
+void malloc_init(size_t arena_retain);
 void* malloc(size_t) __attribute__((malloc));
 void* calloc(size_t, size_t) __attribute__((malloc));
 void* realloc(void*, size_t);
 void free(void*);
+void malloc_print_stats(void);
 
 #endif /* threads/malloc.h */
@@ -1,14 +1,14 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,20 +23,74 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed as a binary buddy system.  A free block
+   of order K is 2**K pages long, starts at a page index that is
+   a multiple of 2**K, and sits on the pool's free list for
+   order K.  An allocation of N pages splits the smallest free
+   block of order at least ceil(log2(N)) down to that order and
+   gives back the tail pages beyond N; freeing a block merges it
+   with its buddy for as long as the buddy is free as a whole.
+   Both take O(log n) steps instead of a scan of the pool.
+
+   The free lists are protected by disabling interrupts rather
+   than by a lock, because thread_switch_tail() frees the page
+   of a dying thread with interrupts off, where it must not
+   block.  Every critical section does a bounded amount of work.
+
+   Each pool also keeps a small reserve of pages that the idle
+   thread has already zeroed, so that single-page PAL_ZERO
+   requests need not clear a page on the spot.  Reserved pages
+   count as allocated, and they are handed back to the buddy
+   system whenever an allocation would otherwise fail. */
+
+/* Number of pre-zeroed pages each pool tries to keep. */
+#define ZERO_RESERVE 16
+
+/* Number of block orders.  The largest block, of order
+   ORDER_CNT - 1, covers 4 GB. */
+#define ORDER_CNT 21
+
+/* Marks the first page of a free block in a pool's ORDERS
+   array, whose low bits hold the block's order.  An allocated
+   page that is part of a group (see palloc_set_group()) holds
+   its distance from the start of the group plus 1, which is less
+   than BLOCK_FREE.  Other pages are 0. */
+#define BLOCK_FREE 0x80
+
+/* Maximum number of pages in a group. */
+#define GROUP_MAX (BLOCK_FREE - 1)
 
 /* A memory pool. */
 struct pool {
-  struct lock lock;        /* Mutual exclusion. */
-  struct bitmap* used_map; /* Bitmap of free pages. */
-  uint8_t* base;           /* Base of pool. */
+  uint8_t* base;                      /* Base of pool. */
+  size_t page_cnt;                    /* Number of pages in pool. */
+  uint8_t* orders;                    /* Per-page BLOCK_FREE | order, tag, or 0. */
+  struct list free_lists[ORDER_CNT];  /* Free blocks of each order. */
+
+  void* zeroed[ZERO_RESERVE]; /* Pre-zeroed pages. */
+  size_t zeroed_cnt;          /* Number of pages in ZEROED. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Statistics. */
+static long long zero_hits;   /* # of PAL_ZERO pages taken pre-zeroed. */
+static long long zero_misses; /* # of PAL_ZERO pages zeroed on demand. */
+
 static void init_pool(struct pool*, void* base, size_t page_cnt, const char* name);
-static bool page_from_pool(const struct pool*, void* page);
+static struct pool* pool_of(const void* page);
+static bool page_from_pool(const struct pool*, const void* page);
+static void* buddy_alloc(struct pool*, size_t page_cnt);
+static void buddy_free(struct pool*, void* pages, size_t page_cnt);
+static void free_block(struct pool*, size_t page_idx, unsigned order);
+static size_t free_block_at(struct pool*, size_t page_idx);
+static bool range_is_allocated(struct pool*, size_t page_idx, size_t page_cnt) UNUSED;
+static bool buddy_claim(struct pool*, size_t page_idx, size_t page_cnt);
+static void release_reserve(struct pool*);
+static bool refill_reserve(struct pool*);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -64,20 +118,27 @@ void palloc_init(size_t user_page_limit) {
    FLAGS, in which case the kernel panics. */
 void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
   struct pool* pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void* pages;
-  size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire(&pool->lock);
-  page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
-  lock_release(&pool->lock);
-
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
+  old_level = intr_disable();
+  if ((flags & PAL_ZERO) && page_cnt == 1 && pool->zeroed_cnt > 0) {
+    pages = pool->zeroed[--pool->zeroed_cnt];
+    zero_hits++;
+    intr_set_level(old_level);
+    return pages;
+  }
+  pages = buddy_alloc(pool, page_cnt);
+  if (pages == NULL && pool->zeroed_cnt > 0) {
+    release_reserve(pool);
+    pages = buddy_alloc(pool, page_cnt);
+  }
+  if (pages != NULL && (flags & PAL_ZERO))
+    zero_misses += page_cnt;
+  intr_set_level(old_level);
 
   if (pages != NULL) {
     if (flags & PAL_ZERO)
@@ -102,57 +163,351 @@ void* palloc_get_page(enum palloc_flags flags) { return palloc_get_multiple(flag
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void palloc_free_multiple(void* pages, size_t page_cnt) {
   struct pool* pool;
-  size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT(pg_ofs(pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
 
-  if (page_from_pool(&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool(&user_pool, pages))
-    pool = &user_pool;
-  else
+  pool = pool_of(pages);
+  if (pool == NULL)
     NOT_REACHED();
 
-  page_idx = pg_no(pages) - pg_no(pool->base);
-
 #ifndef NDEBUG
   memset(pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable();
+  buddy_free(pool, pages, page_cnt);
+  intr_set_level(old_level);
 }
 
 /* Frees the page at PAGE. */
 void palloc_free_page(void* page) { palloc_free_multiple(page, 1); }
 
+/* Tries to grow the allocation of PAGE_CNT pages at PAGES to
+   NEW_CNT pages without moving it, by taking the pages that
+   follow it.  Returns true if successful.  Returns false,
+   changing nothing, if any of those pages is not free. */
+bool palloc_extend(void* pages, size_t page_cnt, size_t new_cnt) {
+  struct pool* pool = pool_of(pages);
+  enum intr_level old_level;
+  size_t page_idx;
+  bool success;
+
+  ASSERT(pool != NULL);
+  ASSERT(pg_ofs(pages) == 0);
+
+  if (new_cnt <= page_cnt)
+    return true;
+  page_idx = pg_no(pages) - pg_no(pool->base);
+  if (new_cnt > pool->page_cnt - page_idx)
+    return false;
+
+  old_level = intr_disable();
+  success = buddy_claim(pool, page_idx + page_cnt, new_cnt - page_cnt);
+  intr_set_level(old_level);
+  return success;
+}
+
+/* Records that the PAGE_CNT allocated pages starting at PAGES
+   form one group, so that palloc_group_head() can find PAGES
+   given any of them.  PAGE_CNT may be at most GROUP_MAX.  The
+   record goes away when the pages are freed. */
+void palloc_set_group(void* pages, size_t page_cnt) {
+  struct pool* pool = pool_of(pages);
+  size_t page_idx, i;
+
+  ASSERT(pool != NULL);
+  ASSERT(pg_ofs(pages) == 0);
+  ASSERT(page_cnt <= GROUP_MAX);
+
+  page_idx = pg_no(pages) - pg_no(pool->base);
+  for (i = 0; i < page_cnt; i++) {
+    ASSERT(pool->orders[page_idx + i] == 0);
+    pool->orders[page_idx + i] = i + 1;
+  }
+}
+
+/* Returns the first page of the group that the page containing
+   ADDR belongs to, or a null pointer if it is not in a group.
+   Takes no locks: a group's record does not change while its
+   pages are allocated. */
+void* palloc_group_head(const void* addr) {
+  struct pool* pool = pool_of(addr);
+  size_t page_idx;
+  uint8_t tag;
+
+  if (pool == NULL)
+    return NULL;
+  page_idx = pg_no(addr) - pg_no(pool->base);
+  tag = pool->orders[page_idx];
+  if (tag == 0 || (tag & BLOCK_FREE))
+    return NULL;
+  return pool->base + PGSIZE * (page_idx - (tag - 1));
+}
+
+/* Returns true if a pool's reserve of pre-zeroed pages is
+   short.  Does not take any locks, so the idle thread can call
+   it with interrupts off; the answer is only a hint. */
+bool palloc_reserve_low(void) {
+  return kernel_pool.zeroed_cnt < ZERO_RESERVE || user_pool.zeroed_cnt < ZERO_RESERVE;
+}
+
+/* Zeros one free page and adds it to the reserve of a pool that
+   is short of pre-zeroed pages.  Returns false if there was
+   nothing to do.  Meant to be called by the idle thread, one
+   page at a time, so that other threads can run in between. */
+bool palloc_reserve_refill(void) {
+  return refill_reserve(&kernel_pool) || refill_reserve(&user_pool);
+}
+
+/* Prints pre-zeroed page statistics. */
+void palloc_print_stats(void) {
+  printf("Palloc: %lld zeroed pages from reserve, %lld zeroed on demand\n", zero_hits,
+         zero_misses);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void init_pool(struct pool* p, void* base, size_t page_cnt, const char* name) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's order map at its base.
+     Calculate the space needed for it
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  size_t map_pages = DIV_ROUND_UP(page_cnt, PGSIZE);
+  unsigned order;
+
+  if (map_pages > page_cnt)
+    PANIC("Not enough memory in %s for order map.", name);
+  page_cnt -= map_pages;
 
   printf("%zu pages available in %s.\n", page_cnt, name);
 
-  /* Initialize the pool. */
-  lock_init(&p->lock);
-  p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  /* Initialize the pool, then free all of its pages. */
+  p->orders = base;
+  memset(p->orders, 0, page_cnt);
+  p->base = base + map_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  for (order = 0; order < ORDER_CNT; order++)
+    list_init(&p->free_lists[order]);
+  p->zeroed_cnt = 0;
+  buddy_free(p, p->base, page_cnt);
+}
+
+/* Returns the smallest order of block that holds PAGE_CNT
+   pages. */
+static unsigned order_for(size_t page_cnt) {
+  unsigned order = 0;
+
+  while (((size_t)1 << order) < page_cnt)
+    order++;
+  return order;
+}
+
+/* Returns the free list element stored in the first page of the
+   block at PAGE_IDX in POOL. */
+static struct list_elem* block_elem(struct pool* pool, size_t page_idx) {
+  return (struct list_elem*)(pool->base + PGSIZE * page_idx);
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   first one, or a null pointer if no free block is large enough.
+   Must be called with interrupts off. */
+static void* buddy_alloc(struct pool* pool, size_t page_cnt) {
+  unsigned want = order_for(page_cnt);
+  unsigned order;
+  size_t page_idx;
+  struct list_elem* e;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  for (order = want; order < ORDER_CNT; order++)
+    if (!list_empty(&pool->free_lists[order]))
+      break;
+  if (order >= ORDER_CNT)
+    return NULL;
+
+  e = list_pop_front(&pool->free_lists[order]);
+  page_idx = ((uint8_t*)e - pool->base) / PGSIZE;
+  pool->orders[page_idx] = 0;
+
+  /* Split off upper halves until the block is the right size. */
+  while (order > want) {
+    size_t buddy;
+
+    order--;
+    buddy = page_idx + ((size_t)1 << order);
+    pool->orders[buddy] = BLOCK_FREE | order;
+    list_push_front(&pool->free_lists[order], block_elem(pool, buddy));
+  }
+
+  /* Give back the pages beyond PAGE_CNT. */
+  if (((size_t)1 << want) > page_cnt) {
+    size_t tail = ((size_t)1 << want) - page_cnt;
+    buddy_free(pool, pool->base + PGSIZE * (page_idx + page_cnt), tail);
+  }
+  return pool->base + PGSIZE * page_idx;
+}
+
+/* Frees the PAGE_CNT pages starting at PAGES in POOL, which need
+   not form a single block, by splitting them into the largest
+   aligned blocks they contain.  Must be called with interrupts
+   off. */
+static void buddy_free(struct pool* pool, void* pages, size_t page_cnt) {
+  size_t page_idx = pg_no(pages) - pg_no(pool->base);
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(page_idx + page_cnt <= pool->page_cnt);
+  ASSERT(range_is_allocated(pool, page_idx, page_cnt));
+
+  /* Forget any group. */
+  memset(pool->orders + page_idx, 0, page_cnt);
+
+  while (page_cnt > 0) {
+    unsigned order = 0;
+
+    while (order + 1 < ORDER_CNT && page_idx % ((size_t)2 << order) == 0 &&
+           ((size_t)2 << order) <= page_cnt)
+      order++;
+    free_block(pool, page_idx, order);
+    page_idx += (size_t)1 << order;
+    page_cnt -= (size_t)1 << order;
+  }
+}
+
+/* Puts the block of 2**ORDER pages at PAGE_IDX in POOL on a free
+   list, merging it with its buddy, and the result with its own
+   buddy, and so on, as long as the buddy is free. */
+static void free_block(struct pool* pool, size_t page_idx, unsigned order) {
+  ASSERT(pool->orders[page_idx] == 0);
+
+  while (order + 1 < ORDER_CNT) {
+    size_t size = (size_t)1 << order;
+    size_t buddy = page_idx ^ size;
+
+    if (buddy + size > pool->page_cnt || pool->orders[buddy] != (BLOCK_FREE | order))
+      break;
+    list_remove(block_elem(pool, buddy));
+    pool->orders[buddy] = 0;
+    if (buddy < page_idx)
+      page_idx = buddy;
+    order++;
+  }
+  pool->orders[page_idx] = BLOCK_FREE | order;
+  list_push_front(&pool->free_lists[order], block_elem(pool, page_idx));
+}
+
+/* Returns true if none of the PAGE_CNT pages starting at
+   PAGE_IDX in POOL is free. */
+static bool range_is_allocated(struct pool* pool, size_t page_idx, size_t page_cnt) {
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    if (free_block_at(pool, page_idx + i) != SIZE_MAX)
+      return false;
+  return true;
+}
+
+/* Returns the page index of the free block in POOL that contains
+   the page at PAGE_IDX, or SIZE_MAX if that page is not free. */
+static size_t free_block_at(struct pool* pool, size_t page_idx) {
+  unsigned order;
+
+  for (order = 0; order < ORDER_CNT; order++) {
+    size_t head = page_idx & ~(((size_t)1 << order) - 1);
+    if (pool->orders[head] == (BLOCK_FREE | order))
+      return head;
+  }
+  return SIZE_MAX;
+}
+
+/* Allocates exactly the PAGE_CNT pages starting at PAGE_IDX in
+   POOL, if they are all free, by taking the free blocks that
+   cover them and freeing again whatever of those blocks lies
+   outside the range.  Returns false, changing nothing, if some
+   page in the range is not free.  Must be called with interrupts
+   off. */
+static bool buddy_claim(struct pool* pool, size_t page_idx, size_t page_cnt) {
+  size_t end = page_idx + page_cnt;
+  size_t pos;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  /* Check first, so that failure leaves POOL untouched. */
+  for (pos = page_idx; pos < end;) {
+    size_t head = free_block_at(pool, pos);
+    if (head == SIZE_MAX)
+      return false;
+    pos = head + ((size_t)1 << (pool->orders[head] & ~BLOCK_FREE));
+  }
+
+  for (pos = page_idx; pos < end;) {
+    size_t head = free_block_at(pool, pos);
+    size_t block_end = head + ((size_t)1 << (pool->orders[head] & ~BLOCK_FREE));
+
+    list_remove(block_elem(pool, head));
+    pool->orders[head] = 0;
+    if (head < page_idx)
+      buddy_free(pool, pool->base + PGSIZE * head, page_idx - head);
+    if (block_end > end)
+      buddy_free(pool, pool->base + PGSIZE * end, block_end - end);
+    pos = block_end;
+  }
+  return true;
+}
+
+/* Returns all of POOL's pre-zeroed pages to the buddy system.
+   Must be called with interrupts off. */
+static void release_reserve(struct pool* pool) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  while (pool->zeroed_cnt > 0)
+    buddy_free(pool, pool->zeroed[--pool->zeroed_cnt], 1);
+}
+
+/* Takes a free page from POOL, zeros it, and adds it to POOL's
+   reserve.  Returns false if the reserve is full or POOL has no
+   free pages.  The page is zeroed with interrupts on, so that
+   the idle thread, which calls this, can be preempted. */
+static bool refill_reserve(struct pool* pool) {
+  enum intr_level old_level;
+  void* page = NULL;
+
+  old_level = intr_disable();
+  if (pool->zeroed_cnt < ZERO_RESERVE)
+    page = buddy_alloc(pool, 1);
+  intr_set_level(old_level);
+  if (page == NULL)
+    return false;
+
+  memset(page, 0, PGSIZE);
+
+  old_level = intr_disable();
+  if (pool->zeroed_cnt < ZERO_RESERVE)
+    pool->zeroed[pool->zeroed_cnt++] = page;
+  else
+    buddy_free(pool, page, 1);
+  intr_set_level(old_level);
+  return true;
+}
+
+/* Returns the pool that PAGE belongs to, or a null pointer if
+   it is in neither pool. */
+static struct pool* pool_of(const void* page) {
+  if (page_from_pool(&kernel_pool, page))
+    return &kernel_pool;
+  else if (page_from_pool(&user_pool, page))
+    return &user_pool;
+  else
+    return NULL;
 }
 
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
-static bool page_from_pool(const struct pool* pool, void* page) {
+static bool page_from_pool(const struct pool* pool, const void* page) {
   size_t page_no = pg_no(page);
   size_t start_page = pg_no(pool->base);
-  size_t end_page = start_page + bitmap_size(pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
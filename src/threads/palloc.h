@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -15,5 +16,11 @@ void* palloc_get_page(enum palloc_flags);
 void* palloc_get_multiple(enum palloc_flags, size_t page_cnt);
 void palloc_free_page(void*);
 void palloc_free_multiple(void*, size_t page_cnt);
+bool palloc_extend(void*, size_t page_cnt, size_t new_cnt);
+void palloc_set_group(void*, size_t page_cnt);
+void* palloc_group_head(const void*);
+bool palloc_reserve_low(void);
+bool palloc_reserve_refill(void);
+void palloc_print_stats(void);
 
 #endif /* threads/palloc.h */
@@ -47,7 +47,8 @@ static inline uintptr_t pd_no(const void* va) { return (uintptr_t)va >> PDSHIFT;
    |         Physical Address           |         Flags          |
    +------------------------------------+------------------------+
 
-   In a PDE, the physical address points to a page table.
+   In a PDE, the physical address points to a page table, or,
+   if PTE_PS is set, to a 4 MB page that the PDE maps directly.
    In a PTE, the physical address points to a data or code page.
    The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
@@ -62,6 +63,7 @@ static inline uintptr_t pd_no(const void* va) { return (uintptr_t)va >> PDSHIFT;
 #define PTE_U 0x4            /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20           /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40           /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80          /* 1=4 MB page, 0=page table (PDEs only). */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create(uint32_t* pt) {
@@ -69,10 +71,22 @@ static inline uint32_t pde_create(uint32_t* pt) {
   return vtop(pt) | PTE_U | PTE_P | PTE_W;
 }
 
+/* Returns a PDE that maps the 4 MB page starting at PAGE, which
+   must be aligned on a 4 MB boundary, for ring 0 code only.  If
+   WRITABLE is true then the page is writable as well as
+   readable.  Requires CR4.PSE to be set.  See [IA32-v3a] 3.7.3
+   "Mixing 4-KByte and 4-MByte Pages". */
+static inline uint32_t pde_create_large(void* page, bool writable) {
+  ASSERT((uintptr_t)page % PTSPAN == 0);
+  return vtop(page) | PTE_PS | PTE_P | (writable ? PTE_W : 0);
+}
+
 /* Returns a pointer to the page table that page directory entry
-   PDE, which must "present", points to. */
+   PDE, which must "present" and not map a 4 MB page, points
+   to. */
 static inline uint32_t* pde_get_pt(uint32_t pde) {
   ASSERT(pde & PTE_P);
+  ASSERT(!(pde & PTE_PS));
   return ptov(pde & PTE_ADDR);
 }
 
@@ -0,0 +1,186 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Object caches.
+
+   malloc() rounds every request up to a power of 2, so a
+   structure just over a power of 2 wastes nearly half of its
+   block, and all structures of similar size share one free list
+   and one lock.  A slab cache instead serves objects of exactly
+   one type.  Each slab is a page holding a header followed by as
+   many objects as fit, rounded only to pointer alignment.  Free
+   objects in a slab are chained through their first word.
+
+   A cache allocates from the slabs on its PARTIAL list, which
+   have at least one free object, and gets a new page from the
+   page allocator only when that list is empty.  One slab that
+   becomes completely free is kept on hand, so that a steady
+   alternation of allocating and freeing a single object does not
+   go back and forth to the page allocator; further empty slabs
+   are returned at once.
+
+   A cache may have a constructor, which initializes each object
+   as slab_alloc() hands it out. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Header at the start of each slab page. */
+struct slab {
+  unsigned magic;            /* Always set to SLAB_MAGIC. */
+  struct slab_cache* cache;  /* Owning cache. */
+  struct list_elem elem;     /* Element in cache's PARTIAL list. */
+  void* free;                /* First free object, or null. */
+  size_t in_use_cnt;         /* Objects allocated from this slab. */
+};
+
+/* All caches, for statistics. */
+static struct list all_caches = LIST_INITIALIZER(all_caches);
+
+static struct slab* slab_create(struct slab_cache*);
+static struct slab* obj_to_slab(struct slab_cache*, void*);
+
+/* Initializes CACHE for objects of OBJ_SIZE bytes, named NAME.
+   If CTOR is non-null, it initializes each object that
+   slab_alloc() returns. */
+void slab_cache_init(struct slab_cache* cache, const char* name, size_t obj_size,
+                     slab_ctor_func* ctor) {
+  ASSERT(obj_size > 0);
+
+  cache->name = name;
+  cache->obj_size = ROUND_UP(obj_size, sizeof(void*));
+  cache->objs_per_slab = (PGSIZE - sizeof(struct slab)) / cache->obj_size;
+  ASSERT(cache->objs_per_slab > 0);
+  cache->ctor = ctor;
+  list_init(&cache->partial);
+  cache->empty_cnt = 0;
+  lock_init(&cache->lock);
+  cache->in_use_cnt = 0;
+  cache->slab_cnt = 0;
+  cache->alloc_cnt = 0;
+  list_push_back(&all_caches, &cache->elem);
+}
+
+/* Allocates and returns an object from CACHE, or a null pointer
+   if memory is not available. */
+void* slab_alloc(struct slab_cache* cache) {
+  struct slab* s;
+  void* obj;
+
+  lock_acquire(&cache->lock);
+  if (list_empty(&cache->partial)) {
+    s = slab_create(cache);
+    if (s == NULL) {
+      lock_release(&cache->lock);
+      return NULL;
+    }
+  } else
+    s = list_entry(list_front(&cache->partial), struct slab, elem);
+
+  obj = s->free;
+  s->free = *(void**)obj;
+  if (s->in_use_cnt++ == 0)
+    cache->empty_cnt--;
+  if (s->in_use_cnt == cache->objs_per_slab)
+    list_remove(&s->elem);
+  cache->in_use_cnt++;
+  cache->alloc_cnt++;
+  lock_release(&cache->lock);
+
+  if (cache->ctor != NULL)
+    cache->ctor(obj);
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from CACHE, to
+   CACHE.  Does nothing if OBJ is null. */
+void slab_free(struct slab_cache* cache, void* obj) {
+  struct slab* s;
+
+  if (obj == NULL)
+    return;
+  s = obj_to_slab(cache, obj);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs. */
+  memset(obj, 0xcc, cache->obj_size);
+#endif
+
+  lock_acquire(&cache->lock);
+  ASSERT(s->in_use_cnt > 0);
+  *(void**)obj = s->free;
+  s->free = obj;
+  if (s->in_use_cnt-- == cache->objs_per_slab)
+    list_push_front(&cache->partial, &s->elem);
+  cache->in_use_cnt--;
+
+  if (s->in_use_cnt == 0) {
+    if (cache->empty_cnt > 0) {
+      list_remove(&s->elem);
+      cache->slab_cnt--;
+      palloc_free_page(s);
+    } else
+      cache->empty_cnt++;
+  }
+  lock_release(&cache->lock);
+}
+
+/* Prints statistics for each cache. */
+void slab_print_stats(void) {
+  struct list_elem* e;
+
+  for (e = list_begin(&all_caches); e != list_end(&all_caches); e = list_next(e)) {
+    struct slab_cache* c = list_entry(e, struct slab_cache, elem);
+    printf("Slab %s: %zu-byte objects, %zu in use, %zu slabs, %lld allocations\n", c->name,
+           c->obj_size, c->in_use_cnt, c->slab_cnt, c->alloc_cnt);
+  }
+}
+
+/* Gets a page for a new slab of CACHE, threads its objects onto
+   the slab's free chain, and puts it on CACHE's PARTIAL list.
+   Returns the slab, or a null pointer if memory is not available.
+   Must be called with CACHE's lock held. */
+static struct slab* slab_create(struct slab_cache* cache) {
+  struct slab* s = palloc_get_page(0);
+  uint8_t* obj;
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = cache;
+  s->free = NULL;
+  s->in_use_cnt = 0;
+  obj = (uint8_t*)(s + 1) + cache->objs_per_slab * cache->obj_size;
+  for (i = 0; i < cache->objs_per_slab; i++) {
+    obj -= cache->obj_size;
+    *(void**)obj = s->free;
+    s->free = obj;
+  }
+
+  list_push_front(&cache->partial, &s->elem);
+  cache->empty_cnt++;
+  cache->slab_cnt++;
+  return s;
+}
+
+/* Returns the slab that OBJ, an object of CACHE, is inside. */
+static struct slab* obj_to_slab(struct slab_cache* cache, void* obj) {
+  struct slab* s = pg_round_down(obj);
+
+  /* Check that the slab is valid and belongs to CACHE. */
+  ASSERT(s->magic == SLAB_MAGIC);
+  ASSERT(s->cache == cache);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT((pg_ofs(obj) - sizeof *s) % cache->obj_size == 0);
+
+  return s;
+}
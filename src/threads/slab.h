@@ -0,0 +1,33 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Initializes a newly allocated object. */
+typedef void slab_ctor_func(void* obj);
+
+/* A cache of objects of one type. */
+struct slab_cache {
+  const char* name;      /* Name, for statistics. */
+  size_t obj_size;       /* Size of each object, rounded for alignment. */
+  size_t objs_per_slab;  /* Number of objects in a slab. */
+  slab_ctor_func* ctor;  /* Constructor, or null. */
+  struct list partial;   /* Slabs with at least one free object. */
+  size_t empty_cnt;      /* Number of slabs on PARTIAL with no objects in use. */
+  struct lock lock;      /* Protects all of the above and the slabs. */
+  struct list_elem elem; /* Element in the list of all caches. */
+
+  /* Statistics. */
+  size_t in_use_cnt;   /* Objects currently allocated. */
+  size_t slab_cnt;     /* Slabs currently held. */
+  long long alloc_cnt; /* Total allocations. */
+};
+
+void slab_cache_init(struct slab_cache*, const char* name, size_t obj_size, slab_ctor_func*);
+void* slab_alloc(struct slab_cache*);
+void slab_free(struct slab_cache*, void*);
+void slab_print_stats(void);
+
+#endif /* threads/slab.h */
@@ -179,6 +179,9 @@ bool compare_lock_priority(struct list_elem *a_elem, struct list_elem *b_elem, v
 }
 
 void thread_update_priority(struct thread* t) {
+  //MLFQS不做优先级捐赠
+  if (active_sched_policy == SCHED_MLFQS)
+    return;
   enum intr_level old_level = intr_disable();
   int lock_priority;
   int max_priority = t->base_priority;
@@ -189,21 +192,14 @@ void thread_update_priority(struct thread* t) {
     if(lock_priority > max_priority)
       max_priority = lock_priority;
   }
-  t->priority = max_priority;
+  thread_change_priority(t, max_priority);
   intr_set_level(old_level);
 }
 
 
 void thread_donate_priority(struct thread* t) {
-  enum intr_level old_level = intr_disable();
-  //首先遍历t的锁列表，更新t的优先级
+  //遍历t的锁列表，更新t的优先级；t在就绪队列时会被移到新优先级的队列
   thread_update_priority(t);
-  //如果t在等待队列就更新队列
-  if(t->status == THREAD_READY) {
-    compare_t less = &compare_lock_priority;
-    list_sort(&ready_list, less, NULL);
-  }
-  intr_set_level(old_level);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
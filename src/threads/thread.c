@@ -4,6 +4,7 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
@@ -24,13 +25,87 @@
    that are ready to run but not actually running. */
 static struct list fifo_ready_list;
 
-
+/* Run queue for the strict-priority and MLFQS schedulers: one
+   FIFO of THREAD_READY threads per priority level, plus a mask
+   with bit P set exactly when prio_queues[P] is nonempty, so
+   that the highest ready priority is found with a bit scan. */
+static struct list prio_queues[PRI_MAX + 1];
+static uint64_t prio_ready_mask;
+static int prio_ready_cnt; /* Threads in all of prio_queues. */
+
+/* Run queue for the fair scheduler: THREAD_READY threads
+   ordered by virtual runtime, the CPU time each has received
+   scaled down by its weight.  The thread that has received the
+   least runs next. */
+static struct rbtree fair_tree;
+static int64_t min_vruntime; /* Never decreases. */
+
+/* Weight of a thread at each priority under the fair scheduler.
+   PRI_DEFAULT weighs FAIR_WEIGHT_DEFAULT, and each priority
+   level up weighs 1/8 more than the one below it, so a thread
+   two levels up gets about 25% more CPU time. */
+static unsigned fair_weights[PRI_MAX + 1];
+#define FAIR_WEIGHT_DEFAULT 1024
+
+/* Virtual runtime charged for a tick at PRI_DEFAULT. */
+#define FAIR_TICK_VRUNTIME 1024
+
+/* Ticks a thread runs before another thread with less virtual
+   runtime can preempt it. */
+#define FAIR_MIN_GRANULARITY 2
+
+/* How far behind min_vruntime a thread that wakes up is placed,
+   to favor threads that sleep a lot without letting them
+   monopolize the CPU after a long sleep. */
+#define FAIR_WAKEUP_CREDIT (3 * FAIR_TICK_VRUNTIME)
+
+/* Run queue for the stride scheduler: THREAD_READY threads
+   ordered by pass.  Every tick a thread runs advances its pass by
+   its stride, STRIDE1 / tickets, and the thread with the least
+   pass runs next, so each thread gets CPU time in exact
+   proportion to its tickets. */
+static struct rbtree stride_tree;
+static int64_t global_pass; /* Never decreases. */
+#define STRIDE1 (1 << 20)
+
+/* The lottery scheduler keeps its THREAD_READY threads on
+   fifo_ready_list and, for each time slice, draws a winner with
+   probability proportional to its tickets.  LOTTERY_TICKETS is
+   the total held by the threads on the list. */
+static long lottery_tickets;
+
+/* Real-time run queues for the EDF scheduler.  A thread with a
+   reservation of BUDGET ticks every PERIOD ticks is real time.
+   Ready real-time threads with budget left sit in edf_tree,
+   ordered by the deadline that ends their current period, and
+   the earliest deadline runs first.  A thread that uses up its
+   budget is throttled on edf_throttled, ordered by deadline,
+   until its next period begins.  Threads without a reservation
+   are best effort: they use the per-priority run queues and run
+   only when no real-time thread can. */
+static struct rbtree edf_tree;
+static struct list edf_throttled;
+static long long edf_misses; /* Deadlines missed by all threads. */
+
+/* Admission control.  The reservations admitted use
+   EDF_UTIL / EDF_UTIL_SCALE of the CPU, which may not exceed
+   EDF_UTIL_MAX, leaving the rest for best-effort threads. */
+#define EDF_UTIL_SCALE 10000
+#define EDF_UTIL_MAX (EDF_UTIL_SCALE * 9 / 10)
+static int edf_util;
+
+/* MLFQS: estimated average number of threads ready to run over
+   the past minute. */
+static fixed_point_t load_avg;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-static struct list sleep_list;//thread 调用thread_sleep会移入这个队列
+/* Sleeping threads, as a pairing heap ordered by wakeup_tick.
+   The root is the next thread to wake, so the timer interrupt
+   does O(1) work on ticks when nothing is due. */
+static struct thread* sleep_heap;
 
 /* Idle thread. */
 static struct thread* idle_thread;
@@ -49,20 +124,75 @@ struct kernel_thread_frame {
 };
 
 /* Statistics. */
-static long long idle_ticks;   /* # of timer ticks spent idle. */
-static long long kernel_ticks; /* # of timer ticks in kernel threads. */
-static long long user_ticks;   /* # of timer ticks in user programs. */
+static long long idle_ticks;       /* # of timer ticks spent idle. */
+static long long kernel_ticks;     /* # of timer ticks in kernel threads. */
+static long long user_ticks;       /* # of timer ticks in user programs. */
+static long long pages_recycled;   /* # of threads created on a cached page. */
+static long long context_switches; /* # of switches to a different thread. */
+#ifdef USERPROG
+static long long pd_reloads_avoided; /* # of switches that kept CR3. */
+#endif
+
+/* Pages of dead threads, kept for thread_create() to reuse so
+   that a new thread usually costs neither a trip through
+   palloc's pool lock nor zeroing a whole page.  Cached pages are
+   linked through their first word.  At most THREAD_CACHE_MAX are
+   kept; the rest go back to palloc.  Accessed only with
+   interrupts off. */
+#define THREAD_CACHE_MAX 16
+static void* thread_cache;
+static size_t thread_cache_cnt;
 
 /* Scheduling. */
 #define TIME_SLICE 4          /* # of timer ticks to give each thread. */
 static unsigned thread_ticks; /* # of timer ticks since last yield. */
 
+/* Round-robin time slices adapt to each thread's behavior
+   between these bounds, set by thread_init().  A thread that
+   uses up its slice looks CPU-bound, so its next slice is twice
+   as long, saving context switches.  A thread that blocks before
+   using up its slice looks I/O-bound, so its next slice is half
+   as long.  In return, when such a thread wakes up, the running
+   thread's slice is cut to the woken thread's, so it waits less
+   for the CPU.  Each thread starts at TIME_SLICE. */
+static int min_time_slice;
+static int max_time_slice;
+static unsigned slice_ticks; /* # of timer ticks in the running slice. */
+
 static void init_thread(struct thread*, const char* name, int priority);
 static bool is_thread(struct thread*) UNUSED;
 static void* alloc_frame(struct thread*, size_t size);
 static void schedule(void);
 static void thread_enqueue(struct thread* t);
+static void prio_dequeue(struct thread* t);
+static bool uses_prio_queues(void);
+static int highest_ready_priority(void);
+static int mlfqs_priority(struct thread* t);
+static void mlfqs_tick(struct thread* t);
+static void mlfqs_decay(struct thread* t);
+static void mlfqs_update_thread(struct thread* t, void* aux);
+static void fair_enqueue(struct thread* t);
+static void fair_update_min_vruntime(void);
+static bool fair_should_preempt(struct thread* t);
+static bool vruntime_less(const struct rb_elem*, const struct rb_elem*, void*);
+static void stride_enqueue(struct thread* t);
+static void stride_update_global_pass(void);
+static bool stride_should_preempt(struct thread* t);
+static bool pass_less(const struct rb_elem*, const struct rb_elem*, void*);
+static bool should_preempt(struct thread* t);
+static bool uses_time_slices(void);
+static void adapt_time_slice(struct thread* t);
+static bool is_realtime(const struct thread* t);
+static int edf_reservation_util(int64_t period, int64_t budget);
+static void edf_enqueue(struct thread* t);
+static void edf_tick(struct thread* t);
+static void edf_replenish(struct thread* t, int64_t now);
+static bool edf_should_preempt(struct thread* t);
+static bool deadline_less(const struct rb_elem*, const struct rb_elem*, void*);
+static bool deadline_list_less(const struct list_elem*, const struct list_elem*, void*);
 static tid_t allocate_tid(void);
+static struct thread* alloc_thread_page(void);
+static void free_thread_page(struct thread* t);
 void thread_switch_tail(struct thread* prev);
 
 static void kernel_thread(thread_func*, void* aux);
@@ -74,6 +204,9 @@ static struct thread* thread_schedule_fifo(void);
 static struct thread* thread_schedule_prio(void);
 static struct thread* thread_schedule_fair(void);
 static struct thread* thread_schedule_mlfqs(void);
+static struct thread* thread_schedule_stride(void);
+static struct thread* thread_schedule_lottery(void);
+static struct thread* thread_schedule_edf(void);
 static struct thread* thread_schedule_reserved(void);
 
 void thread_sleep(int64_t start, int64_t sleep);
@@ -81,7 +214,8 @@ void check_sleep_list(void);
 /* Determines which scheduler the kernel should use.
    Controlled by the kernel command-line options
     "-sched=fifo", "-sched=prio",
-    "-sched=fair". "-sched=mlfqs"
+    "-sched=fair". "-sched=mlfqs",
+    "-sched=stride", "-sched=lottery", "-sched=edf"
    Is equal to SCHED_FIFO by default. */
 enum sched_policy active_sched_policy;
 
@@ -93,8 +227,8 @@ typedef struct thread* scheduler_func(void);
    policy in use by the kernel. */
 scheduler_func* scheduler_jump_table[8] = {thread_schedule_fifo,     thread_schedule_prio,
                                            thread_schedule_fair,     thread_schedule_mlfqs,
-                                           thread_schedule_reserved, thread_schedule_reserved,
-                                           thread_schedule_reserved, thread_schedule_reserved};
+                                           thread_schedule_stride,   thread_schedule_lottery,
+                                           thread_schedule_edf,      thread_schedule_reserved};
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -107,21 +241,46 @@ scheduler_func* scheduler_jump_table[8] = {thread_schedule_fifo,     thread_sche
    allocator before trying to create any threads with
    thread_create().
 
+   Time slices adapt between SLICE_MIN and SLICE_MAX ticks.
+
    It is not safe to call thread_current() until this function
    finishes. */
-void thread_init(void) {
+void thread_init(int slice_min, int slice_max) {
+  int pri;
+
   ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(1 <= slice_min && slice_min <= slice_max);
+
+  min_time_slice = slice_min;
+  max_time_slice = slice_max;
 
   lock_init(&tid_lock);
   list_init(&fifo_ready_list);
   list_init(&all_list);
-  list_init(&sleep_list);
-  list_init(&ready_list);
+  for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+    list_init(&prio_queues[pri]);
+  prio_ready_mask = 0;
+  prio_ready_cnt = 0;
+  load_avg = fix_int(0);
+  rb_init(&fair_tree, vruntime_less, NULL);
+  min_vruntime = 0;
+  fair_weights[PRI_DEFAULT] = FAIR_WEIGHT_DEFAULT;
+  for (pri = PRI_DEFAULT + 1; pri <= PRI_MAX; pri++)
+    fair_weights[pri] = fair_weights[pri - 1] * 9 / 8;
+  for (pri = PRI_DEFAULT - 1; pri >= PRI_MIN; pri--)
+    fair_weights[pri] = fair_weights[pri + 1] * 8 / 9;
+  rb_init(&stride_tree, pass_less, NULL);
+  global_pass = 0;
+  lottery_tickets = 0;
+  rb_init(&edf_tree, deadline_less, NULL);
+  list_init(&edf_throttled);
+  edf_util = 0;
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread();
   init_thread(initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid();
+  slice_ticks = initial_thread->time_slice;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -154,15 +313,216 @@ void thread_tick(void) {
   else
     kernel_ticks++;
 
+  if (active_sched_policy == SCHED_MLFQS)
+    mlfqs_tick(t);
+  else if (active_sched_policy == SCHED_FAIR && t != idle_thread)
+    t->vruntime += FAIR_TICK_VRUNTIME * FAIR_WEIGHT_DEFAULT / fair_weights[t->priority];
+  else if (active_sched_policy == SCHED_STRIDE && t != idle_thread)
+    t->pass += STRIDE1 / t->tickets;
+  else if (active_sched_policy == SCHED_EDF)
+    edf_tick(t);
+
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  thread_ticks++;
+  if (should_preempt(t))
     intr_yield_on_return();
 }
 
+/* Returns true if running thread T should give up the CPU at the
+   end of the current timer tick. */
+static bool should_preempt(struct thread* t) {
+  switch (active_sched_policy) {
+    case SCHED_FAIR:
+      return fair_should_preempt(t);
+    case SCHED_STRIDE:
+      return stride_should_preempt(t);
+    case SCHED_EDF:
+      return edf_should_preempt(t);
+    case SCHED_MLFQS:
+      return thread_ticks >= TIME_SLICE;
+    default:
+      return thread_ticks >= slice_ticks;
+  }
+}
+
+/* Returns true if the active scheduling policy preempts threads
+   when their time slices run out.  MLFQS is left out, because
+   its priority calculations assume a fixed TIME_SLICE. */
+static bool uses_time_slices(void) {
+  return active_sched_policy == SCHED_FIFO || active_sched_policy == SCHED_PRIO ||
+         active_sched_policy == SCHED_LOTTERY || active_sched_policy == SCHED_EDF;
+}
+
+/* Resizes the time slice of thread T, which is giving up the CPU,
+   according to how much of its last slice it used.  Threads that
+   yield voluntarily or are preempted early keep their slice. */
+static void adapt_time_slice(struct thread* t) {
+  if (t == idle_thread || !uses_time_slices())
+    return;
+  if (t->status == THREAD_READY && thread_ticks >= (unsigned)t->time_slice)
+    t->time_slice = t->time_slice * 2 < max_time_slice ? t->time_slice * 2 : max_time_slice;
+  else if (t->status == THREAD_BLOCKED && thread_ticks < (unsigned)t->time_slice)
+    t->time_slice = t->time_slice / 2 > min_time_slice ? t->time_slice / 2 : min_time_slice;
+}
+
+/* Accounts for a timer tick that the idle thread slept through
+   with the timer in tickless mode (see timer_idle_enter()).
+   Unlike thread_tick(), this may run outside interrupt context
+   and never preempts. */
+void thread_idle_tick(void) {
+  idle_ticks++;
+  if (active_sched_policy == SCHED_MLFQS && timer_ticks() % TIMER_FREQ == 0)
+    mlfqs_decay(idle_thread);
+}
+
+/* Returns true if the fair scheduler should preempt thread T,
+   which is running: T has run for at least the minimum
+   granularity and some ready thread has less virtual runtime. */
+static bool fair_should_preempt(struct thread* t) {
+  struct rb_elem* e = rb_min(&fair_tree);
+
+  if (e == NULL)
+    return false;
+  if (t == idle_thread)
+    return true;
+  return thread_ticks >= FAIR_MIN_GRANULARITY &&
+         rb_entry(e, struct thread, fair_elem)->vruntime < t->vruntime;
+}
+
+/* Returns true if the stride scheduler should preempt thread T,
+   which is running: some ready thread has a smaller pass. */
+static bool stride_should_preempt(struct thread* t) {
+  struct rb_elem* e = rb_min(&stride_tree);
+
+  if (e == NULL)
+    return false;
+  return t == idle_thread || rb_entry(e, struct thread, pass_elem)->pass < t->pass;
+}
+
+/* Does the EDF bookkeeping for a timer tick in which thread T
+   was running: charges T's budget, starts the next period of
+   each thread whose deadline has arrived, and releases throttled
+   threads whose new period has begun. */
+static void edf_tick(struct thread* t) {
+  int64_t now = timer_ticks();
+  struct rb_elem* e;
+
+  if (is_realtime(t)) {
+    if (t->rt_remaining > 0)
+      t->rt_remaining--;
+    if (t->rt_deadline <= now)
+      edf_replenish(t, now);
+  }
+
+  while (!list_empty(&edf_throttled)) {
+    struct thread* r = list_entry(list_front(&edf_throttled), struct thread, elem);
+    if (r->rt_deadline > now)
+      break;
+    list_pop_front(&edf_throttled);
+    edf_replenish(r, now);
+    rb_insert(&edf_tree, &r->edf_elem);
+  }
+
+  while ((e = rb_min(&edf_tree)) != NULL &&
+         rb_entry(e, struct thread, edf_elem)->rt_deadline <= now) {
+    rb_remove(&edf_tree, e);
+    edf_replenish(rb_entry(e, struct thread, edf_elem), now);
+    rb_insert(&edf_tree, e);
+  }
+}
+
+/* Starts the first period of real-time thread T's reservation
+   that ends after NOW, with a full budget.  If T was runnable and
+   still had budget left in the period that just ended, it missed
+   its deadline. */
+static void edf_replenish(struct thread* t, int64_t now) {
+  if (t->rt_remaining > 0) {
+    t->rt_misses++;
+    edf_misses++;
+  }
+  do
+    t->rt_deadline += t->rt_period;
+  while (t->rt_deadline <= now);
+  t->rt_remaining = t->rt_budget;
+}
+
+/* Returns true if the EDF scheduler should preempt thread T,
+   which is running.  A real-time thread runs until its budget is
+   used up or a thread with an earlier deadline is ready.  A
+   best-effort thread gives way to any ready real-time thread,
+   and otherwise runs for a time slice. */
+static bool edf_should_preempt(struct thread* t) {
+  struct rb_elem* e = rb_min(&edf_tree);
+
+  if (is_realtime(t))
+    return t->rt_remaining == 0 ||
+           (e != NULL && rb_entry(e, struct thread, edf_elem)->rt_deadline < t->rt_deadline);
+  return e != NULL || thread_ticks >= slice_ticks;
+}
+
+/* Does the MLFQS bookkeeping for timer tick in which thread T
+   was running.  Only T's recent_cpu changes from tick to tick,
+   so every fourth tick only T's priority is recomputed.  Once
+   per second load_avg and every thread's recent_cpu decay, and
+   then all priorities are recomputed. */
+static void mlfqs_tick(struct thread* t) {
+  int64_t ticks = timer_ticks();
+
+  if (t != idle_thread)
+    t->recent_cpu = fix_add(t->recent_cpu, fix_int(1));
+
+  if (ticks % TIMER_FREQ == 0)
+    mlfqs_decay(t);
+  else if (ticks % 4 == 0 && t != idle_thread)
+    thread_change_priority(t, mlfqs_priority(t));
+
+  if (prio_ready_mask != 0 && highest_ready_priority() > t->priority)
+    intr_yield_on_return();
+}
+
+/* Does the MLFQS bookkeeping due once per second, at a timer
+   tick in which thread T was running: updates load_avg, then
+   decays every thread's recent_cpu and recomputes its
+   priority. */
+static void mlfqs_decay(struct thread* t) {
+  int ready = prio_ready_cnt + (t != idle_thread);
+
+  load_avg = fix_add(fix_mul(fix_frac(59, 60), load_avg), fix_scale(fix_frac(1, 60), ready));
+  thread_foreach(mlfqs_update_thread, NULL);
+}
+
+/* Decays the recent_cpu of thread T and recomputes its
+   priority.  Called once per second for every thread. */
+static void mlfqs_update_thread(struct thread* t, void* aux UNUSED) {
+  fixed_point_t twice_load = fix_scale(load_avg, 2);
+
+  if (t == idle_thread)
+    return;
+  t->recent_cpu = fix_add(fix_mul(fix_div(twice_load, fix_add(twice_load, fix_int(1))),
+                                  t->recent_cpu),
+                          fix_int(t->nice));
+  thread_change_priority(t, mlfqs_priority(t));
+}
+
+/* Returns the MLFQS priority of thread T, computed from its
+   recent_cpu and nice values. */
+static int mlfqs_priority(struct thread* t) {
+  int priority = PRI_MAX - fix_trunc(fix_unscale(t->recent_cpu, 4)) - t->nice * 2;
+
+  return priority < PRI_MIN ? PRI_MIN : priority > PRI_MAX ? PRI_MAX : priority;
+}
+
 /* Prints thread statistics. */
 void thread_print_stats(void) {
   printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n", idle_ticks, kernel_ticks,
          user_ticks);
+  printf("Thread: %lld created on recycled pages\n", pages_recycled);
+  printf("Thread: %lld context switches\n", context_switches);
+  if (active_sched_policy == SCHED_EDF)
+    printf("Thread: %lld EDF deadlines missed\n", edf_misses);
+#ifdef USERPROG
+  printf("Thread: %lld page directory reloads avoided\n", pd_reloads_avoided);
+#endif
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -190,7 +550,7 @@ tid_t thread_create(const char* name, int priority, thread_func* function, void*
   ASSERT(function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page(PAL_ZERO);
+  t = alloc_thread_page();
   if (t == NULL)
     return TID_ERROR;
 
@@ -213,6 +573,10 @@ tid_t thread_create(const char* name, int priority, thread_func* function, void*
   sf->eip = switch_entry;
   sf->ebp = 0;
 
+  /* Under MLFQS, init_thread() computed T's priority and ignored
+     PRIORITY.  Read it before T can run and exit. */
+  priority = t->priority;
+
   /* Add to run queue. */
   thread_unblock(t);
   if(thread_current()->priority < priority)
@@ -252,13 +616,171 @@ static void thread_enqueue(struct thread* t) {
 
   if (active_sched_policy == SCHED_FIFO)
     list_push_back(&fifo_ready_list, &t->elem);
-  else {
-    if(active_sched_policy == SCHED_PRIO) {
-      bool(*less)(struct list_elem*, struct list_elem*, void*) = &less_priority;
-      list_insert_ordered(&ready_list, &t->elem, less ,NULL);
-    }
+  else if (active_sched_policy == SCHED_EDF && is_realtime(t))
+    edf_enqueue(t);
+  else if (active_sched_policy == SCHED_LOTTERY) {
+    list_push_back(&fifo_ready_list, &t->elem);
+    lottery_tickets += t->tickets;
+  } else if (uses_prio_queues()) {
+    list_push_back(&prio_queues[t->priority], &t->elem);
+    prio_ready_mask |= (uint64_t)1 << t->priority;
+    prio_ready_cnt++;
+  } else if (active_sched_policy == SCHED_FAIR)
+    fair_enqueue(t);
+  else if (active_sched_policy == SCHED_STRIDE)
+    stride_enqueue(t);
+}
+
+/* Returns true if T holds an EDF reservation. */
+static bool is_realtime(const struct thread* t) { return t->rt_period != 0; }
+
+/* Adds real-time thread T to the EDF run queue, or throttles it if
+   it has no budget left.  A thread that wakes up after its
+   deadline starts a fresh period. */
+static void edf_enqueue(struct thread* t) {
+  int64_t now = timer_ticks();
+
+  if (t->status == THREAD_BLOCKED && t->rt_deadline <= now) {
+    t->rt_deadline = now + t->rt_period;
+    t->rt_remaining = t->rt_budget;
   }
+  if (t->rt_remaining > 0)
+    rb_insert(&edf_tree, &t->edf_elem);
+  else
+    list_insert_ordered(&edf_throttled, &t->elem, deadline_list_less, NULL);
+}
 
+/* Orders threads in edf_tree by deadline. */
+static bool deadline_less(const struct rb_elem* a_, const struct rb_elem* b_, void* aux UNUSED) {
+  const struct thread* a = rb_entry(a_, struct thread, edf_elem);
+  const struct thread* b = rb_entry(b_, struct thread, edf_elem);
+
+  return a->rt_deadline < b->rt_deadline;
+}
+
+/* Orders threads in edf_throttled by deadline. */
+static bool deadline_list_less(const struct list_elem* a_, const struct list_elem* b_,
+                               void* aux UNUSED) {
+  const struct thread* a = list_entry(a_, struct thread, elem);
+  const struct thread* b = list_entry(b_, struct thread, elem);
+
+  return a->rt_deadline < b->rt_deadline;
+}
+
+/* Adds T to the fair scheduler's run queue.  A thread that is
+   waking up is placed no further behind than FAIR_WAKEUP_CREDIT
+   before the least virtual runtime of the others, so that it
+   does not make up for all the time it slept. */
+static void fair_enqueue(struct thread* t) {
+  fair_update_min_vruntime();
+  if (t->status == THREAD_BLOCKED && t->vruntime < min_vruntime - FAIR_WAKEUP_CREDIT)
+    t->vruntime = min_vruntime - FAIR_WAKEUP_CREDIT;
+  rb_insert(&fair_tree, &t->fair_elem);
+}
+
+/* Advances min_vruntime to the least virtual runtime among the
+   running thread and the ready threads, if that is larger. */
+static void fair_update_min_vruntime(void) {
+  struct thread* cur = running_thread();
+  struct rb_elem* e = rb_min(&fair_tree);
+  int64_t least = INT64_MAX;
+
+  if (cur != idle_thread && cur->status == THREAD_RUNNING)
+    least = cur->vruntime;
+  if (e != NULL && rb_entry(e, struct thread, fair_elem)->vruntime < least)
+    least = rb_entry(e, struct thread, fair_elem)->vruntime;
+  if (least != INT64_MAX && least > min_vruntime)
+    min_vruntime = least;
+}
+
+/* Orders threads by virtual runtime. */
+static bool vruntime_less(const struct rb_elem* a_, const struct rb_elem* b_, void* aux UNUSED) {
+  const struct thread* a = rb_entry(a_, struct thread, fair_elem);
+  const struct thread* b = rb_entry(b_, struct thread, fair_elem);
+
+  return a->vruntime < b->vruntime;
+}
+
+/* Adds T to the stride scheduler's run queue.  A thread that is
+   waking up starts no further back than the least pass of the
+   others, so that it cannot bank the time it spent blocked. */
+static void stride_enqueue(struct thread* t) {
+  stride_update_global_pass();
+  if (t->status == THREAD_BLOCKED && t->pass < global_pass)
+    t->pass = global_pass;
+  rb_insert(&stride_tree, &t->pass_elem);
+}
+
+/* Advances global_pass to the least pass among the running
+   thread and the ready threads, if that is larger. */
+static void stride_update_global_pass(void) {
+  struct thread* cur = running_thread();
+  struct rb_elem* e = rb_min(&stride_tree);
+  int64_t least = INT64_MAX;
+
+  if (cur != idle_thread && cur->status == THREAD_RUNNING)
+    least = cur->pass;
+  if (e != NULL && rb_entry(e, struct thread, pass_elem)->pass < least)
+    least = rb_entry(e, struct thread, pass_elem)->pass;
+  if (least != INT64_MAX && least > global_pass)
+    global_pass = least;
+}
+
+/* Orders threads by stride scheduler pass. */
+static bool pass_less(const struct rb_elem* a_, const struct rb_elem* b_, void* aux UNUSED) {
+  const struct thread* a = rb_entry(a_, struct thread, pass_elem);
+  const struct thread* b = rb_entry(b_, struct thread, pass_elem);
+
+  return a->pass < b->pass;
+}
+
+/* Returns true if the active scheduler keeps ready threads in
+   the per-priority run queues.  Under EDF, only best-effort
+   threads are kept there. */
+static bool uses_prio_queues(void) {
+  return active_sched_policy == SCHED_PRIO || active_sched_policy == SCHED_MLFQS ||
+         active_sched_policy == SCHED_EDF;
+}
+
+/* Removes ready thread T from the per-priority run queues.
+   This function must be called with interrupts turned off. */
+static void prio_dequeue(struct thread* t) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(t->status == THREAD_READY);
+
+  list_remove(&t->elem);
+  if (list_empty(&prio_queues[t->priority]))
+    prio_ready_mask &= ~((uint64_t)1 << t->priority);
+  prio_ready_cnt--;
+}
+
+/* Returns the highest priority with a nonempty run queue.
+   PRIO_READY_MASK must be nonzero. */
+static int highest_ready_priority(void) {
+  uint32_t high = prio_ready_mask >> 32;
+  uint32_t low = prio_ready_mask;
+
+  ASSERT(prio_ready_mask != 0);
+  return high != 0 ? 63 - __builtin_clz(high) : 31 - __builtin_clz(low);
+}
+
+/* Sets the effective priority of thread T to PRIORITY.  If T is
+   ready to run, it moves to the back of the run queue for its
+   new priority.  This function must be called with interrupts
+   turned off. */
+void thread_change_priority(struct thread* t, int priority) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(is_thread(t));
+  ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (t->priority == priority)
+    return;
+  if (t->status == THREAD_READY && uses_prio_queues() && !is_realtime(t)) {
+    prio_dequeue(t);
+    t->priority = priority;
+    thread_enqueue(t);
+  } else
+    t->priority = priority;
 }
 
 /* Transitions a blocked thread T to the ready-to-run state.
@@ -278,9 +800,59 @@ void thread_unblock(struct thread* t) {
   ASSERT(t->status == THREAD_BLOCKED);
   thread_enqueue(t);
   t->status = THREAD_READY;
+  if (uses_time_slices() && (unsigned)t->time_slice < slice_ticks &&
+      (active_sched_policy == SCHED_FIFO || active_sched_policy == SCHED_LOTTERY ||
+       t->priority >= running_thread()->priority))
+    slice_ticks = t->time_slice;
   intr_set_level(old_level);
 }
 
+/* Melds pairing heaps A and B and returns the new root.  On a
+   tie A stays on top. */
+static struct thread* sleep_heap_meld(struct thread* a, struct thread* b) {
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+  if (b->wakeup_tick < a->wakeup_tick) {
+    struct thread* tmp = a;
+    a = b;
+    b = tmp;
+  }
+  b->sleep_sibling = a->sleep_child;
+  a->sleep_child = b;
+  return a;
+}
+
+/* Combines the sibling list starting at FIRST into one heap using
+   the standard two-pass pairing: meld adjacent pairs left to
+   right, then meld the results right to left.  The pairs are
+   threaded back through sleep_sibling so that no recursion or
+   allocation is needed with interrupts off. */
+static struct thread* sleep_heap_merge_pairs(struct thread* first) {
+  struct thread* pairs = NULL;
+  struct thread* heap = NULL;
+
+  while (first != NULL) {
+    struct thread* a = first;
+    struct thread* b = a->sleep_sibling;
+    first = b != NULL ? b->sleep_sibling : NULL;
+    a->sleep_sibling = NULL;
+    if (b != NULL)
+      b->sleep_sibling = NULL;
+    a = sleep_heap_meld(a, b);
+    a->sleep_sibling = pairs;
+    pairs = a;
+  }
+  while (pairs != NULL) {
+    struct thread* next = pairs->sleep_sibling;
+    pairs->sleep_sibling = NULL;
+    heap = sleep_heap_meld(heap, pairs);
+    pairs = next;
+  }
+  return heap;
+}
+
 /**/
 void thread_sleep(int64_t start, int64_t sleep) {
   struct thread *t = thread_current();
@@ -288,10 +860,11 @@ void thread_sleep(int64_t start, int64_t sleep) {
   if(sleep <= 0)
     return;
   enum intr_level old_level = intr_disable();
-  //将线程放入sleep队列，修改状态
-  list_push_back(&sleep_list, &t->elem);
-  t->start_tick = start;
-  t->sleep_tick = sleep;
+  //按绝对唤醒时刻插入sleep堆，修改状态
+  t->wakeup_tick = start + sleep;
+  t->sleep_child = NULL;
+  t->sleep_sibling = NULL;
+  sleep_heap = sleep_heap_meld(sleep_heap, t);
   thread_block();
   intr_set_level(old_level);
 }
@@ -336,6 +909,7 @@ void thread_exit(void) {
      when it calls thread_switch_tail(). */
   intr_disable();
   list_remove(&thread_current()->allelem);
+  edf_util -= edf_reservation_util(thread_current()->rt_period, thread_current()->rt_budget);
   thread_current()->status = THREAD_DYING;
   schedule();
   NOT_REACHED();
@@ -372,6 +946,9 @@ void thread_foreach(thread_action_func* func, void* aux) {
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void thread_set_priority(int new_priority) { 
+  //MLFQS自己计算优先级，忽略设置
+  if (active_sched_policy == SCHED_MLFQS)
+    return;
   enum intr_level old_level = intr_disable();
   int old_priority = thread_current()->priority;
   thread_current()->base_priority = new_priority; 
@@ -387,26 +964,94 @@ void thread_set_priority(int new_priority) {
 /* Returns the current thread's priority. */
 int thread_get_priority(void) { return thread_current()->priority; }
 
-/* Sets the current thread's nice value to NICE. */
-void thread_set_nice(int nice UNUSED) { /* Not yet implemented. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest. */
+void thread_set_nice(int nice) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+
+  ASSERT(NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable();
+  cur->nice = nice;
+  if (active_sched_policy == SCHED_MLFQS) {
+    thread_change_priority(cur, mlfqs_priority(cur));
+    if (prio_ready_mask != 0 && highest_ready_priority() > cur->priority)
+      thread_yield();
+  }
+  intr_set_level(old_level);
 }
 
 /* Returns the current thread's nice value. */
-int thread_get_nice(void) {
-  /* Not yet implemented. */
-  return 0;
+int thread_get_nice(void) { return thread_current()->nice; }
+
+/* Sets the current thread's stride and lottery tickets to
+   TICKETS.  Threads it creates afterward start with as many. */
+void thread_set_tickets(int tickets) {
+  ASSERT(TICKETS_MIN <= tickets && tickets <= TICKETS_MAX);
+  thread_current()->tickets = tickets;
+}
+
+/* Returns the current thread's tickets. */
+int thread_get_tickets(void) { return thread_current()->tickets; }
+
+/* Returns the fraction of the CPU, in units of 1/EDF_UTIL_SCALE,
+   that a reservation of BUDGET ticks every PERIOD ticks uses,
+   rounded up. */
+static int edf_reservation_util(int64_t period, int64_t budget) {
+  return period != 0 ? DIV_ROUND_UP(budget * EDF_UTIL_SCALE, period) : 0;
+}
+
+/* Gives the current thread an EDF reservation of BUDGET ticks of
+   CPU time in every period of PERIOD ticks, starting now, making
+   it a real-time thread.  A PERIOD of 0 cancels the reservation.
+   Returns false, leaving any earlier reservation in place, if the
+   EDF scheduler is not active, the reservation is malformed, or
+   admitting it would commit more than EDF_UTIL_MAX of the CPU. */
+bool thread_set_reservation(int64_t period, int64_t budget) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+  int util;
+
+  if (active_sched_policy != SCHED_EDF || period < 0 ||
+      (period != 0 && (budget <= 0 || budget > period)))
+    return false;
+
+  old_level = intr_disable();
+  util = edf_util - edf_reservation_util(cur->rt_period, cur->rt_budget) +
+         edf_reservation_util(period, budget);
+  if (util > EDF_UTIL_MAX) {
+    intr_set_level(old_level);
+    return false;
+  }
+  edf_util = util;
+  cur->rt_period = period;
+  cur->rt_budget = period != 0 ? budget : 0;
+  cur->rt_deadline = timer_ticks() + period;
+  cur->rt_remaining = cur->rt_budget;
+  thread_yield();
+  intr_set_level(old_level);
+  return true;
 }
 
+/* Returns the number of EDF deadlines the current thread has
+   missed. */
+int thread_get_deadline_misses(void) { return thread_current()->rt_misses; }
+
 /* Returns 100 times the system load average. */
 int thread_get_load_avg(void) {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable();
+  int load_avg_100 = fix_round(fix_scale(load_avg, 100));
+  intr_set_level(old_level);
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int thread_get_recent_cpu(void) {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable();
+  int recent_cpu_100 = fix_round(fix_scale(thread_current()->recent_cpu, 100));
+  intr_set_level(old_level);
+  return recent_cpu_100;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -428,6 +1073,16 @@ static void idle(void* idle_started_ UNUSED) {
     intr_disable();
     thread_block();
 
+    /* Nobody else is ready.  Spend the time zeroing a page for
+       palloc's reserve, with interrupts on, then come back
+       around so that any thread woken meanwhile runs first. */
+    if (palloc_reserve_low()) {
+      intr_enable();
+      if (palloc_reserve_refill())
+        continue;
+      intr_disable();
+    }
+
     /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -439,7 +1094,11 @@ static void idle(void* idle_started_ UNUSED) {
          time.
 
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-         7.11.1 "HLT Instruction". */
+         7.11.1 "HLT Instruction".
+
+         With tickless idle, the next timer interrupt may not come
+         until the next sleeping thread is due to wake up. */
+    timer_idle_enter();
     asm volatile("sti; hlt" : : : "memory");
   }
 }
@@ -481,7 +1140,28 @@ static void init_thread(struct thread* t, const char* name, int priority) {
   t->status = THREAD_BLOCKED;
   strlcpy(t->name, name, sizeof t->name);
   t->stack = (uint8_t*)t + PGSIZE;
+
+  /* A new thread inherits its creator's tickets. */
+  t->tickets = TICKETS_DEFAULT;
+  if (running_thread() != t && is_thread(running_thread()))
+    t->tickets = running_thread()->tickets;
+
+  /* Under MLFQS a new thread inherits its creator's nice and
+     recent_cpu, and PRIORITY is ignored. */
+  if (active_sched_policy == SCHED_MLFQS) {
+    struct thread* creator = running_thread();
+    if (creator != t && is_thread(creator)) {
+      t->nice = creator->nice;
+      t->recent_cpu = creator->recent_cpu;
+    }
+    priority = mlfqs_priority(t);
+  }
   t->priority = priority;
+  t->vruntime = min_vruntime;
+  t->pass = global_pass;
+  t->time_slice = TIME_SLICE < min_time_slice   ? min_time_slice
+                  : TIME_SLICE > max_time_slice ? max_time_slice
+                                                : TIME_SLICE;
   t->pcb = NULL;
   t->magic = THREAD_MAGIC;
   list_init(&t->lock_list);
@@ -513,22 +1193,76 @@ static struct thread* thread_schedule_fifo(void) {
     return idle_thread;
 }
 
-/* Strict priority scheduler */
+/* Strict priority scheduler.  Also picks the next thread for
+   MLFQS, whose priorities thread_tick() keeps up to date. */
 static struct thread* thread_schedule_prio(void) {
-  if (!list_empty(&ready_list))
-    return list_entry(list_pop_front(&ready_list), struct thread, elem);
-  else
+  if (prio_ready_mask != 0) {
+    struct thread* t =
+        list_entry(list_front(&prio_queues[highest_ready_priority()]), struct thread, elem);
+    prio_dequeue(t);
+    return t;
+  } else
     return idle_thread;
 }
 
 /* Fair priority scheduler */
 static struct thread* thread_schedule_fair(void) {
-  PANIC("Unimplemented scheduler policy: \"-sched=fair\"");
+  struct rb_elem* e = rb_min(&fair_tree);
+
+  if (e != NULL) {
+    rb_remove(&fair_tree, e);
+    return rb_entry(e, struct thread, fair_elem);
+  } else
+    return idle_thread;
 }
 
 /* Multi-level feedback queue scheduler */
-static struct thread* thread_schedule_mlfqs(void) {
-  PANIC("Unimplemented scheduler policy: \"-sched=mlfqs\"");
+static struct thread* thread_schedule_mlfqs(void) { return thread_schedule_prio(); }
+
+/* Stride scheduler */
+static struct thread* thread_schedule_stride(void) {
+  struct rb_elem* e = rb_min(&stride_tree);
+
+  if (e != NULL) {
+    rb_remove(&stride_tree, e);
+    return rb_entry(e, struct thread, pass_elem);
+  } else
+    return idle_thread;
+}
+
+/* Lottery scheduler: draws a ticket at random among those held
+   by the ready threads and runs the thread holding it. */
+static struct thread* thread_schedule_lottery(void) {
+  struct list_elem* e;
+  struct thread* t;
+  unsigned long winner;
+
+  if (list_empty(&fifo_ready_list))
+    return idle_thread;
+
+  winner = random_ulong() % lottery_tickets;
+  for (e = list_begin(&fifo_ready_list);; e = list_next(e)) {
+    t = list_entry(e, struct thread, elem);
+    if (winner < (unsigned long)t->tickets)
+      break;
+    winner -= t->tickets;
+  }
+  list_remove(e);
+  lottery_tickets -= t->tickets;
+  return t;
+}
+
+/* Earliest-deadline-first scheduler: the ready real-time thread
+   with the earliest deadline, or else the highest-priority
+   best-effort thread. */
+static struct thread* thread_schedule_edf(void) {
+  struct rb_elem* e = rb_min(&edf_tree);
+
+  if (e != NULL) {
+    rb_remove(&edf_tree, e);
+    return rb_entry(e, struct thread, edf_elem);
+  } else
+    return thread_schedule_prio();
 }
 
 /* Not an actual scheduling policy — placeholder for empty
@@ -572,10 +1306,14 @@ void thread_switch_tail(struct thread* prev) {
 
   /* Start new time slice. */
   thread_ticks = 0;
+  slice_ticks = cur->time_slice;
 
 #ifdef USERPROG
-  /* Activate the new address space. */
-  process_activate();
+  /* Activate the new address space.  If schedule() picked the
+     thread that was already running, nothing changed, not even
+     the kernel stack in the TSS. */
+  if (prev != NULL && !process_activate())
+    pd_reloads_avoided++;
 #endif
 
   /* If the thread we switched from is dying, destroy its struct
@@ -585,20 +1323,33 @@ void thread_switch_tail(struct thread* prev) {
      palloc().) */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) {
     ASSERT(prev != cur);
-    palloc_free_page(prev);
+    free_thread_page(prev);
   }
 }
 
-void check_sleep_list(void) {//检查sleep list有没有需要唤醒的
-  struct list_elem *e, *next;
-  for(e = list_begin(&sleep_list); e != list_end(&sleep_list); e = next) {
-    next = list_next(e);
-    struct thread *t = list_entry(e, struct thread, elem);
-    if(timer_elapsed(t->start_tick) >= t->sleep_tick) {
-      list_remove(e);
-      thread_unblock(t);
-    }
-  }  
+//返回最早需要定时器唤醒的时刻：睡眠线程醒来，或者被节流的EDF线程进入下个周期
+//都没有就返回INT64_MAX
+int64_t thread_next_wakeup(void) {
+  int64_t next = sleep_heap != NULL ? sleep_heap->wakeup_tick : INT64_MAX;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  if (!list_empty(&edf_throttled)) {
+    struct thread* t = list_entry(list_front(&edf_throttled), struct thread, elem);
+    if (t->rt_deadline < next)
+      next = t->rt_deadline;
+  }
+  return next;
+}
+
+void check_sleep_list(void) {//检查sleep堆有没有需要唤醒的
+  int64_t now = timer_ticks();
+  //堆顶是最早醒来的线程，没有到期的就直接返回
+  while (sleep_heap != NULL && sleep_heap->wakeup_tick <= now) {
+    struct thread* t = sleep_heap;
+    sleep_heap = sleep_heap_merge_pairs(t->sleep_child);
+    t->sleep_child = NULL;
+    thread_unblock(t);
+  }
 }
 
 
@@ -611,18 +1362,59 @@ void check_sleep_list(void) {//检查sleep list有没有需要唤醒的
    has completed. */
 static void schedule(void) {
   struct thread* cur = running_thread();
-  struct thread* next = next_thread_to_run();
+  struct thread* next;
   struct thread* prev = NULL;
 
   ASSERT(intr_get_level() == INTR_OFF);
   ASSERT(cur->status != THREAD_RUNNING);
+
+  /* Bring the tick count up to date before choosing, in case the
+     idle thread left the timer in one-shot mode. */
+  if (cur == idle_thread)
+    timer_idle_exit();
+  adapt_time_slice(cur);
+  next = next_thread_to_run();
   ASSERT(is_thread(next));
 
-  if (cur != next)
+  if (cur != next) {
+    context_switches++;
     prev = switch_threads(cur, next);
+  }
   thread_switch_tail(prev);
 }
 
+/* Returns a page for a new thread's struct thread and kernel
+   stack, preferably one cached by free_thread_page().  Only the
+   struct thread at the bottom of the page needs to be clean, and
+   init_thread() clears it, so the page is not zeroed. */
+static struct thread* alloc_thread_page(void) {
+  enum intr_level old_level = intr_disable();
+  void* page = thread_cache;
+
+  if (page != NULL) {
+    thread_cache = *(void**)page;
+    thread_cache_cnt--;
+    pages_recycled++;
+  }
+  intr_set_level(old_level);
+
+  return page != NULL ? page : palloc_get_page(0);
+}
+
+/* Releases the page of dead thread T, keeping it in the thread
+   cache if there is room. */
+static void free_thread_page(struct thread* t) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (thread_cache_cnt < THREAD_CACHE_MAX) {
+    t->magic = 0;
+    *(void**)t = thread_cache;
+    thread_cache = t;
+    thread_cache_cnt++;
+  } else
+    palloc_free_page(t);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t allocate_tid(void) {
   static tid_t next_tid = 1;
@@ -3,6 +3,7 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
 #include "threads/synch.h"
 #include "threads/fixed-point.h"
@@ -25,6 +26,17 @@ typedef int tid_t;
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX 63     /* Highest priority. */
 
+/* Thread nice values, for the MLFQS scheduler. */
+#define NICE_MIN -20 /* Nicest to other threads. */
+#define NICE_DEFAULT 0
+#define NICE_MAX 20 /* Least nice. */
+
+/* Thread tickets, for the stride and lottery schedulers.  A
+   thread's share of the CPU is proportional to its tickets. */
+#define TICKETS_MIN 1
+#define TICKETS_DEFAULT 100
+#define TICKETS_MAX 10000
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -90,10 +102,25 @@ struct thread {
   int priority;              /* Priority. */
   struct list_elem allelem;  /* List element for all threads list. */
 
-  /*添加sleep tick*/
-  int64_t start_tick;       /*thread准备什么时候睡*/
-  int64_t sleep_tick;       /*thread睡多长时间*/
+  /*sleep heap：按唤醒时刻排序的配对堆*/
+  int64_t wakeup_tick;          /*thread醒来的绝对tick*/
+  struct thread* sleep_child;   /*配对堆中最左的孩子*/
+  struct thread* sleep_sibling; /*配对堆中右边的兄弟*/
   int base_priority;
+  int nice;                  /* MLFQS niceness. */
+  fixed_point_t recent_cpu;  /* MLFQS recent CPU time. */
+  int64_t vruntime;          /* Fair scheduler virtual runtime. */
+  struct rb_elem fair_elem;  /* Element in fair scheduler run queue. */
+  int tickets;               /* Stride and lottery share of the CPU. */
+  int64_t pass;              /* Stride scheduler pass. */
+  struct rb_elem pass_elem;  /* Element in stride scheduler run queue. */
+  int64_t rt_period;         /* EDF reservation period, or 0 if none. */
+  int64_t rt_budget;         /* EDF ticks of CPU time per period. */
+  int64_t rt_deadline;       /* End of the current EDF period. */
+  int64_t rt_remaining;      /* EDF budget left in this period. */
+  int rt_misses;             /* EDF deadlines missed. */
+  struct rb_elem edf_elem;   /* Element in EDF run queue. */
+  int time_slice;            /* Round-robin time slice, in ticks. */
   struct list lock_list;
   struct lock *wait_lock;
   /* Shared between thread.c and synch.c. */
@@ -111,23 +138,27 @@ struct thread {
 /* Types of scheduler that the user can request the kernel
  * use to schedule threads at runtime. */
 enum sched_policy {
-  SCHED_FIFO,  // First-in, first-out scheduler
-  SCHED_PRIO,  // Strict-priority scheduler with round-robin tiebreaking
-  SCHED_FAIR,  // Implementation-defined fair scheduler
-  SCHED_MLFQS, // Multi-level Feedback Queue Scheduler
+  SCHED_FIFO,    // First-in, first-out scheduler
+  SCHED_PRIO,    // Strict-priority scheduler with round-robin tiebreaking
+  SCHED_FAIR,    // Implementation-defined fair scheduler
+  SCHED_MLFQS,   // Multi-level Feedback Queue Scheduler
+  SCHED_STRIDE,  // Proportional-share stride scheduler
+  SCHED_LOTTERY, // Proportional-share lottery scheduler
+  SCHED_EDF,     // Earliest-deadline-first real time, strict priority otherwise
 };
 #define SCHED_DEFAULT SCHED_FIFO
 
 /* Determines which scheduling policy the kernel should use.
- * Controller by the kernel command-line options
- *  "-sched-default", "-sched-fair", "-sched-mlfqs", "-sched-fifo"
+ * Controller by the kernel command-line option "-sched=POLICY",
+ * e.g. "-sched=fifo", "-sched=prio", "-sched=fair", "-sched=mlfqs".
  * Is equal to SCHED_FIFO by default. */
 extern enum sched_policy active_sched_policy;
-struct list ready_list;
-void thread_init(void);
+
+void thread_init(int slice_min, int slice_max);
 void thread_start(void);
 
 void thread_tick(void);
+void thread_idle_tick(void);
 void thread_print_stats(void);
 
 typedef void thread_func(void* aux);
@@ -149,13 +180,21 @@ void thread_foreach(thread_action_func*, void*);
 
 int thread_get_priority(void);
 void thread_set_priority(int);
+void thread_change_priority(struct thread*, int priority);
 
 int thread_get_nice(void);
 void thread_set_nice(int);
 int thread_get_recent_cpu(void);
 int thread_get_load_avg(void);
 
+int thread_get_tickets(void);
+void thread_set_tickets(int);
+
+bool thread_set_reservation(int64_t period, int64_t budget);
+int thread_get_deadline_misses(void);
+
 void thread_sleep(int64_t start, int64_t sleep);
 void check_sleep_list(void);
+int64_t thread_next_wakeup(void);
 bool less_priority(struct list_elem *insert_elem, struct list_elem *e, void* aux);
 #endif /* threads/thread.h */
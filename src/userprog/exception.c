@@ -5,6 +5,11 @@
 #include "userprog/process.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -57,7 +62,14 @@ void exception_init(void) {
 }
 
 /* Prints exception statistics. */
-void exception_print_stats(void) { printf("Exception: %lld page faults\n", page_fault_cnt); }
+void exception_print_stats(void) {
+  printf("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+  page_print_stats();
+  frame_print_stats();
+  swap_print_stats();
+#endif
+}
 
 /* Handler for an exception (probably) caused by a user process. */
 static void kill(struct intr_frame* f) {
@@ -136,6 +148,18 @@ static void page_fault(struct intr_frame* f) {
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* Bring in the page if it belongs to the process's address
+     space.  This also covers the kernel touching user memory on
+     the process's behalf. */
+  if (not_present && page_fault_in(fault_addr, write))
+    return;
+#else
+  /* Heap pages are mapped the first time they are touched. */
+  if (not_present && process_heap_fault(fault_addr))
+    return;
+#endif
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
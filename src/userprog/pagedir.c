@@ -6,7 +6,14 @@
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
+/* A range with more than this many mapped pages is invalidated
+   by flushing the whole TLB instead of one page at a time.  Past
+   this point, the INVLPGs cost more than refilling the TLB
+   after a flush. */
+#define INVLPG_MAX 32
+
 static void invalidate_pagedir(uint32_t*);
+static void invalidate_page(uint32_t*, const void*);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -58,7 +65,11 @@ static uint32_t* lookup_page(uint32_t* pd, const void* vaddr, bool create) {
   /* Check for a page table for VADDR.
      If one is missing, create one if requested. */
   pde = pd + pd_no(vaddr);
-  if (*pde == 0) {
+  if (*pde & PTE_PS) {
+    /* Part of the kernel's 4 MB direct map: there is no page
+       table, and thus no PTE, for VADDR. */
+    return NULL;
+  } else if (*pde == 0) {
     if (create) {
       pt = palloc_get_page(PAL_ZERO);
       if (pt == NULL)
@@ -132,7 +143,40 @@ void pagedir_clear_page(uint32_t* pd, void* upage) {
   pte = lookup_page(pd, upage, false);
   if (pte != NULL && (*pte & PTE_P) != 0) {
     *pte &= ~PTE_P;
+    invalidate_page(pd, upage);
+  }
+}
+
+/* Marks the PAGE_CNT user virtual pages starting at UPAGE "not
+   present" in page directory PD, as if by pagedir_clear_page(),
+   but invalidates the TLB only once for the whole range: page
+   by page for the pages that were actually mapped, or by
+   flushing the entire TLB if there were more than INVLPG_MAX of
+   them. */
+void pagedir_clear_range(uint32_t* pd, void* upage, size_t page_cnt) {
+  uint8_t* first = upage;
+  void* cleared[INVLPG_MAX];
+  size_t cleared_cnt = 0;
+  size_t i;
+
+  ASSERT(pg_ofs(upage) == 0);
+  ASSERT(is_user_vaddr(upage));
+
+  for (i = 0; i < page_cnt; i++) {
+    uint32_t* pte = lookup_page(pd, first + i * PGSIZE, false);
+    if (pte != NULL && (*pte & PTE_P) != 0) {
+      *pte &= ~PTE_P;
+      if (cleared_cnt < INVLPG_MAX)
+        cleared[cleared_cnt] = first + i * PGSIZE;
+      cleared_cnt++;
+    }
+  }
+
+  if (cleared_cnt > INVLPG_MAX)
     invalidate_pagedir(pd);
+  else {
+    for (i = 0; i < cleared_cnt; i++)
+      invalidate_page(pd, cleared[i]);
   }
 }
 
@@ -154,7 +198,7 @@ void pagedir_set_dirty(uint32_t* pd, const void* vpage, bool dirty) {
       *pte |= PTE_D;
     else {
       *pte &= ~(uint32_t)PTE_D;
-      invalidate_pagedir(pd);
+      invalidate_page(pd, vpage);
     }
   }
 }
@@ -177,7 +221,7 @@ void pagedir_set_accessed(uint32_t* pd, const void* vpage, bool accessed) {
       *pte |= PTE_A;
     else {
       *pte &= ~(uint32_t)PTE_A;
-      invalidate_pagedir(pd);
+      invalidate_page(pd, vpage);
     }
   }
 }
@@ -222,3 +266,11 @@ static void invalidate_pagedir(uint32_t* pd) {
     pagedir_activate(pd);
   }
 }
+
+/* Invalidates the TLB entry for virtual page VPAGE if PD is the
+   active page directory, leaving the rest of the TLB intact.
+   See [IA32-v2a] "INVLPG--Invalidate TLB Entry". */
+static void invalidate_page(uint32_t* pd, const void* vpage) {
+  if (active_pd() == pd)
+    asm volatile("invlpg (%0)" : : "r"(vpage) : "memory");
+}
@@ -16,11 +16,16 @@
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "filesys/inode.h"
 #include "userprog/syscall.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
 static thread_func start_pthread NO_RETURN;
@@ -36,6 +41,24 @@ static struct lock pthread_lock_lock;
 static struct lock pthread_sema_lock;
 static int file_descriptor = 5;
 
+//常用结构体的slab缓存，代替malloc
+static struct slab_cache process_file_cache;
+static struct slab_cache child_process_cache;
+static struct slab_cache thread_process_cache;
+
+static void child_process_ctor(void* obj) {
+  struct child_process* child = obj;
+  child->exit_status = 0;
+  sema_init(&child->exit_wait, 0);
+}
+
+static void thread_process_ctor(void* obj) {
+  struct thread_process* pthread_process = obj;
+  pthread_process->pthread_exit_status = false;
+  pthread_process->has_joined = false;
+  sema_init(&pthread_process->pthread_exit_wait, 0);
+}
+
 struct mul_args {
   char * process_cmd;
   pid_t father_pid;
@@ -54,7 +77,7 @@ int allocate_fd(void) {
 }
 
 int process_openfile(struct file* file) {
-  struct process_file *pfile = (struct process_file*)malloc(sizeof(struct process_file));
+  struct process_file *pfile = slab_alloc(&process_file_cache);
   if(pfile == NULL)
   return -1;
   struct thread* t = thread_current();
@@ -84,8 +107,9 @@ void close_file(int fd) {
     struct process_file * pfile = list_entry(e, struct process_file, file_elem);
     if(pfile->fd == fd) {
       list_remove(&pfile->file_elem);
+      slab_free(&process_file_cache, pfile);
+      break;
     }
-      
   }
 }
 
@@ -111,6 +135,11 @@ void userprog_init(void) {
   lock_init(&pthread_lock);
   lock_init(&pthread_lock_lock);
   lock_init(&pthread_sema_lock);
+  slab_cache_init(&process_file_cache, "process_file", sizeof(struct process_file), NULL);
+  slab_cache_init(&child_process_cache, "child_process", sizeof(struct child_process),
+                  child_process_ctor);
+  slab_cache_init(&thread_process_cache, "thread_process", sizeof(struct thread_process),
+                  thread_process_ctor);
   /* Kill the kernel if we did not succeed */
   ASSERT(success);
 }
@@ -152,7 +181,7 @@ pid_t process_execute(const char* proc_cmd) {
     return TID_ERROR;
   };
 
-  process_child = (struct child_process*)malloc(sizeof(struct child_process));
+  process_child = slab_alloc(&child_process_cache);
   if(process_child == NULL) {
     palloc_free_page(fn_copy);
     free(process_args);
@@ -160,8 +189,6 @@ pid_t process_execute(const char* proc_cmd) {
   };
   process_child->child_pid = tid;
   process_child->father_pid = t->tid;
-  process_child->exit_status = 0;
-  sema_init(&process_child->exit_wait, 0);
   list_push_back(&list_all_children, &process_child->child_elem);
 
   sema_up(&process_args->child_exec_sema);
@@ -217,6 +244,13 @@ static void start_process(void* args_) {
     list_init(&t->pcb->process_lock_list);
     list_init(&t->pcb->process_sema_list);
     t->pcb->pthread_count = 0;
+    lock_init(&t->pcb->heap_lock);
+    t->pcb->heap_start = t->pcb->heap_end = NULL;
+#ifdef VM
+    list_init(&t->pcb->mmap_list);
+    t->pcb->next_mapid = 0;
+    success = page_table_init(t->pcb);
+#endif
   }
 
   /* Initialize interrupt frame and load executable. */
@@ -277,6 +311,9 @@ static void start_process(void* args_) {
     // If this happens, then an unfortuantely timed timer interrupt
     // can try to activate the pagedir, but it is now freed memory
     struct process* pcb_to_free = t->pcb;
+#ifdef VM
+    page_table_destroy(pcb_to_free);
+#endif
     t->pcb = NULL;
     free(pcb_to_free);
   }
@@ -334,19 +371,20 @@ int process_wait(pid_t child_pid) {
     sema_down(&child->exit_wait);
     int exit_status = child->exit_status;
     list_remove(&child->child_elem);
-    free(child);
+    slab_free(&child_process_cache, child);
   return exit_status;
 }
 
 void kill_all_child(pid_t father_pid) {
   lock_acquire(&list_lock);
 
-  struct list_elem * e;
-  for(e = list_begin(&list_all_children); e != list_end(&list_all_children); e = list_next(e)) {
+  struct list_elem * e, *next;
+  for(e = list_begin(&list_all_children); e != list_end(&list_all_children); e = next) {
     struct child_process *child = list_entry(e, struct child_process, child_elem);
+    next = list_next(e);
     if(child->father_pid == father_pid) {
       list_remove(&child->child_elem);
-      free(child);
+      slab_free(&child_process_cache, child);
     }
   }
   lock_release(&list_lock);
@@ -359,7 +397,7 @@ void close_all_file(struct process *p) {
     struct process_file *pro_file = list_entry(e, struct process_file, file_elem);
     list_remove(&pro_file->file_elem);
     file_close(pro_file->file);
-    free(pro_file);
+    slab_free(&process_file_cache, pro_file);
   }
 }
 
@@ -387,6 +425,10 @@ void process_exit(int status) {
          that's been freed (and cleared). */
     cur->pcb->pagedir = NULL;
     pagedir_activate(NULL);
+#ifdef VM
+    page_table_destroy(cur->pcb);
+    mmap_exit(cur->pcb);
+#endif
     pagedir_destroy(pd);
   }
 
@@ -414,19 +456,26 @@ void process_exit(int status) {
 }
 
 /* Sets up the CPU for running user code in the current
-   thread. This function is called on every context switch. */
-void process_activate(void) {
+   thread. This function is called on every context switch.
+   Returns false if the thread's page directory was already
+   active, so that CR3 did not have to be reloaded (and the TLB
+   flushed), as when switching between threads of one process. */
+bool process_activate(void) {
   struct thread* t = thread_current();
+  uint32_t* pd = init_page_dir;
+  bool switched;
 
   /* Activate thread's page tables. */
   if (t->pcb != NULL && t->pcb->pagedir != NULL)
-    pagedir_activate(t->pcb->pagedir);
-  else
-    pagedir_activate(NULL);
+    pd = t->pcb->pagedir;
+  switched = active_pd() != pd;
+  if (switched)
+    pagedir_activate(pd);
 
   /* Set thread's kernel stack for use in processing interrupts.
      This does nothing if this is not a user process. */
   tss_update();
+  return switched;
 }
 
 /* We load ELF binaries.  The following definitions are taken
@@ -573,11 +622,19 @@ bool load(const char* file_name, void (**eip)(void), void** esp) {
           }
           if (!load_segment(file, file_page, (void*)mem_page, read_bytes, zero_bytes, writable))
             goto done;
+
+          /* The heap starts on the page after the last segment. */
+          if ((uint8_t*)mem_page + read_bytes + zero_bytes > t->pcb->heap_start)
+            t->pcb->heap_start = (uint8_t*)mem_page + read_bytes + zero_bytes;
         } else
           goto done;
         break;
     }
   }
+  t->pcb->heap_end = t->pcb->heap_start;
+#ifndef VM
+  t->pcb->heap_touched = t->pcb->heap_start;
+#endif
 
   /* Set up stack. */
   if (!setup_stack(esp))
@@ -601,7 +658,9 @@ done:
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page(void* upage, void* kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -666,7 +725,9 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
   ASSERT(pg_ofs(upage) == 0);
   ASSERT(ofs % PGSIZE == 0);
 
+#ifndef VM
   file_seek(file, ofs);
+#endif
   while (read_bytes > 0 || zero_bytes > 0) {
     /* Calculate how to fill this page.
          We will read PAGE_READ_BYTES bytes from FILE
@@ -674,6 +735,15 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
     size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
     size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+    /* Record the page; it is read in when first touched. */
+    bool added = page_read_bytes > 0
+                     ? page_add_file(upage, file, ofs, page_read_bytes, writable)
+                     : page_add_zero(upage, writable);
+    if (!added)
+      return false;
+    ofs += page_read_bytes;
+#else
     /* Get a page of memory. */
     uint8_t* kpage = palloc_get_page(PAL_USER);
     if (kpage == NULL)
@@ -691,6 +761,7 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
       palloc_free_page(kpage);
       return false;
     }
+#endif
 
     /* Advance. */
     read_bytes -= page_read_bytes;
@@ -703,6 +774,13 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
 /* Create a minimal stack by mapping a zeroed page at the top of
    user virtual memory. */
 static bool setup_stack(void** esp) {
+#ifdef VM
+  uint8_t* upage = ((uint8_t*)PHYS_BASE) - PGSIZE;
+  if (!page_add_zero(upage, true) || !page_fault_in(upage, true))
+    return false;
+  *esp = PHYS_BASE;
+  return true;
+#else
   uint8_t* kpage;
   bool success = false;
 
@@ -715,6 +793,7 @@ static bool setup_stack(void** esp) {
       palloc_free_page(kpage);
   }
   return success;
+#endif
 }
 
 /* Adds a mapping from user virtual address UPAGE to kernel
@@ -726,6 +805,7 @@ static bool setup_stack(void** esp) {
    with palloc_get_page().
    Returns true on success, false if UPAGE is already mapped or
    if memory allocation fails. */
+#ifndef VM
 static bool install_page(void* upage, void* kpage, bool writable) {
   struct thread* t = thread_current();
 
@@ -734,6 +814,92 @@ static bool install_page(void* upage, void* kpage, bool writable) {
   return (pagedir_get_page(t->pcb->pagedir, upage) == NULL &&
           pagedir_set_page(t->pcb->pagedir, upage, kpage, writable));
 }
+#endif
+
+/* Lowest address the heap may not grow past, leaving room for
+   the stacks at the top of user virtual memory. */
+#define HEAP_LIMIT ((uint8_t*)PHYS_BASE - MAX_STACK_PAGES * PGSIZE)
+
+/* Moves the current process's break to NEW_END, which lies
+   between the start of the heap and HEAP_LIMIT.  Pages the heap
+   gains are mapped when they are first touched; of the pages it
+   loses, only those that were touched are unmapped.  Returns
+   false, leaving the heap unchanged, if the heap would grow over
+   other mappings.  Must be called with heap_lock held. */
+static bool heap_set_break(uint8_t* new_end) {
+#ifdef VM
+  return page_set_break(new_end);
+#else
+  struct process* pcb = thread_current()->pcb;
+  uint8_t* upage;
+
+  for (upage = pg_round_up(new_end); upage < pcb->heap_touched; upage += PGSIZE) {
+    void* kpage = pagedir_get_page(pcb->pagedir, upage);
+    if (kpage != NULL) {
+      pagedir_clear_page(pcb->pagedir, upage);
+      palloc_free_page(kpage);
+    }
+  }
+  if (pcb->heap_touched > (uint8_t*)pg_round_up(new_end))
+    pcb->heap_touched = pg_round_up(new_end);
+  pcb->heap_end = new_end;
+  return true;
+#endif
+}
+
+/* Moves the end of the current process's heap by INCREMENT
+   bytes, which may be negative.  Returns the previous break, or
+   (void*) -1 if the heap would shrink below its start, grow into
+   the stacks, or grow over other mappings, in which case the
+   heap is unchanged. */
+void* process_sbrk(intptr_t increment) {
+  struct process* pcb = thread_current()->pcb;
+  uint8_t* old_end;
+  uint8_t* new_end;
+
+  lock_acquire(&pcb->heap_lock);
+  old_end = pcb->heap_end;
+  new_end = old_end + increment;
+  if ((increment < 0 ? new_end < pcb->heap_start || new_end > old_end
+                     : new_end > HEAP_LIMIT || new_end < old_end) ||
+      !heap_set_break(new_end)) {
+    lock_release(&pcb->heap_lock);
+    return (void*)-1;
+  }
+  lock_release(&pcb->heap_lock);
+  return old_end;
+}
+
+#ifndef VM
+/* Maps a zeroed page at UADDR, which was just faulted on, if it
+   lies in a page of the current process's heap that has not been
+   touched yet.  Returns true if UADDR is mapped afterward. */
+bool process_heap_fault(const void* uaddr) {
+  struct process* pcb = thread_current()->pcb;
+  uint8_t* upage = pg_round_down(uaddr);
+  bool success = false;
+
+  if (pcb == NULL || pcb->pagedir == NULL)
+    return false;
+
+  lock_acquire(&pcb->heap_lock);
+  if (upage >= pcb->heap_start && upage < (uint8_t*)pg_round_up(pcb->heap_end)) {
+    if (pagedir_get_page(pcb->pagedir, upage) != NULL)
+      success = true;
+    else {
+      uint8_t* kpage = palloc_get_page(PAL_USER | PAL_ZERO);
+      if (kpage != NULL && install_page(upage, kpage, true)) {
+        if (upage >= pcb->heap_touched)
+          pcb->heap_touched = upage + PGSIZE;
+        success = true;
+      } else
+        palloc_free_page(kpage);
+    }
+  }
+  lock_release(&pcb->heap_lock);
+  return success;
+}
+#endif
 
 /* Returns true if t is the main thread of the process p */
 bool is_main_thread(struct thread* t, struct process* p) { return p->main_thread == t; }
@@ -750,6 +916,13 @@ pid_t get_pid(struct process* p) { return (pid_t)p->main_thread->tid; }
    now, it does nothing. You may find it necessary to change the
    function signature. */
 bool setup_thread(void** esp, int num) {
+#ifdef VM
+  uint8_t* base = (uint8_t*)PHYS_BASE - (PGSIZE * 2 * num);
+  if (!page_add_zero(base - PGSIZE, true) || !page_fault_in(base - PGSIZE, true))
+    return false;
+  *esp = base;
+  return true;
+#else
   uint8_t* kpage;
   bool success = false;
 
@@ -763,6 +936,7 @@ bool setup_thread(void** esp, int num) {
       palloc_free_page(kpage);
   }
   return success;
+#endif
 }
 
 struct pthread_args {
@@ -826,7 +1000,7 @@ static void start_pthread(void* args_) {
   struct intr_frame if_;
   bool success;
 
-  struct thread_process *pthread_process = (struct thread_process*)malloc(sizeof(struct thread_process));
+  struct thread_process *pthread_process = slab_alloc(&thread_process_cache);
   if(pthread_process == NULL) {
     t_args->is_setup = false;
     sema_up(&t_args->pthread_setup_sema);
@@ -883,9 +1057,6 @@ esp->
 
  //初始化pthread_process
   pthread_process->tid = t->tid;
-  pthread_process->pthread_exit_status = false;
-  pthread_process->has_joined = false;
-  sema_init(&pthread_process->pthread_exit_wait, 0);
 //插入到list,需要加锁
   lock_acquire(&pthread_lock);
   list_push_back(&t_args->pcb->pthread_list, &pthread_process->pthread_elem);
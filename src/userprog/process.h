@@ -4,6 +4,9 @@
 #include "threads/thread.h"
 #include <stdint.h>
 #include<list.h>
+#ifdef VM
+#include <hash.h>
+#endif
 // At most 8MB can be allocated to the stack
 // These defines will be used in Project 2: Multithreading
 #define MAX_STACK_PAGES (1 << 11)
@@ -34,6 +37,20 @@ struct process {
   struct list process_lock_list; //保存进程下所有的锁
   struct list process_sema_list;
   int pthread_count;
+  struct lock heap_lock;     /* Serializes moving the break. */
+  uint8_t* heap_start;       /* Start of the heap, just past the data. */
+  uint8_t* heap_end;         /* Current break, the end of the heap. */
+#ifdef VM
+  struct hash spt;           /* Supplemental page table (vm/page.c). */
+  struct lock spt_lock;      /* Guards spt, rss, and heap_pages. */
+  size_t rss;                /* Resident pages. */
+  size_t rss_limit;          /* Soft limit on rss, 0 for none. */
+  struct list mmap_list;     /* Memory-mapped files (vm/mmap.c). */
+  int next_mapid;            /* Identifier for the next mapping. */
+  struct list heap_pages;    /* Heap pages touched so far (vm/page.c). */
+#else
+  uint8_t* heap_touched;     /* End of the highest heap page touched. */
+#endif
 };
 
 //子进程列表，需要保存返回状态，需要知道自己的pid，需要信号量来判断是否执行完成，需要知道父进程pid
@@ -81,7 +98,11 @@ void userprog_init(void);
 pid_t process_execute(const char* file_name);
 int process_wait(pid_t);
 void process_exit(int);
-void process_activate(void);
+bool process_activate(void);
+void* process_sbrk(intptr_t increment);
+#ifndef VM
+bool process_heap_fault(const void* uaddr);
+#endif
 
 bool is_main_thread(struct thread*, struct process*);
 pid_t get_pid(struct process*);
@@ -6,10 +6,15 @@
 #include "userprog/process.h"
 #include "threads/vaddr.h"
 #include "devices/shutdown.h"
+#include "devices/timer.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "filesys/inode.h"
 #include "lib/float.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 struct lock file_lock;
 
 void exit_process(void) {
@@ -19,12 +24,34 @@ void exit_process(void) {
 
 //检查传入的地址是否有效
 void check_valid(uint32_t* p) {
-  if(p == NULL || !is_user_vaddr(p) || pagedir_get_page(thread_current()->pcb->pagedir, p) == NULL) {
+  if(p == NULL || !is_user_vaddr(p)) {
     exit_process();
   }
+#ifdef VM
+  //页面可能还没加载，先把它换进来
+  if(pagedir_get_page(thread_current()->pcb->pagedir, p) == NULL && !page_fault_in(p, false)) {
+    exit_process();
+  }
+#else
+  //堆上的页第一次访问时才映射
+  if(pagedir_get_page(thread_current()->pcb->pagedir, p) == NULL && !process_heap_fault(p)) {
+    exit_process();
+  }
+#endif
   return;
 }
 
+#ifdef VM
+//read会写进buffer，buffer所在的页必须可写（只读页可能和别的进程共享）
+static void check_writable(void* p, unsigned size) {
+  uint8_t* upage = pg_round_down(p);
+  for(; upage < (uint8_t*)p + size; upage += PGSIZE) {
+    if(!is_user_vaddr(upage) || !page_fault_in(upage, true))
+      exit_process();
+  }
+}
+#endif
+
 /*
   uint32_t*addr = p;
   while(len) {
@@ -169,6 +196,20 @@ void syscall_close(int fd) {
   lock_release(&file_lock);
 }
 
+#ifdef VM
+//mmap用自己重新打开的file，这样close(fd)之后映射依然有效
+static mapid_t syscall_mmap(int fd, void* addr) {
+  lock_acquire(&file_lock);
+  struct file* file = find_file(fd);
+  if(file != NULL)
+    file = file_reopen(file);
+  lock_release(&file_lock);
+  if(file == NULL)
+    return MAP_FAILED;
+  return mmap_map(file, addr);
+}
+#endif
+
 static void syscall_handler(struct intr_frame*);
 
 void syscall_init(void) { 
@@ -176,6 +217,13 @@ void syscall_init(void) {
   lock_init(&file_lock);
   }
 
+//64位的返回值放在edx:eax里
+static void syscall_clock_ns(struct intr_frame* f) {
+  int64_t ns = timer_ns();
+  f->eax = (uint32_t)ns;
+  f->edx = (uint32_t)(ns >> 32);
+}
+
 static void syscall_handler(struct intr_frame* f) {
   uint32_t* args = ((uint32_t*)f->esp);
 
@@ -233,6 +281,9 @@ static void syscall_handler(struct intr_frame* f) {
     case SYS_READ:
         check_argv(args+1, 3);
         check_pointer((void*)args[2], args[3]);
+#ifdef VM
+        check_writable((void*)args[2], args[3]);
+#endif
         f->eax = syscall_read(args[1], (void*)args[2], (size_t)args[3]);
         break;
     case SYS_WRITE:
@@ -291,12 +342,50 @@ static void syscall_handler(struct intr_frame* f) {
         check_argv(args+1, 1);
         f->eax = user_sema_up(args[1]);
         break;
-<<<<<<< HEAD
     case SYS_GET_TID:
       f->eax = thread_current()->tid;
         break;
-=======
->>>>>>> a922f815a7ce5c7c772ee8c42c53c6749058e0c5
+    case SYS_SBRK:
+        check_argv(args+1, 1);
+        f->eax = (uint32_t)process_sbrk(args[1]);
+        break;
+    case SYS_CLOCK_NS:
+        syscall_clock_ns(f);
+        break;
+    case SYS_SET_TICKETS:
+        check_argv(args+1, 1);
+        //票数超出范围就返回false
+        if((int)args[1] < TICKETS_MIN || (int)args[1] > TICKETS_MAX) {
+          f->eax = false;
+          break;
+        }
+        thread_set_tickets(args[1]);
+        f->eax = true;
+        break;
+    case SYS_RT_RESERVE:
+        check_argv(args+1, 2);
+        f->eax = thread_set_reservation((int)args[1], (int)args[2]);
+        break;
+#ifdef VM
+    case SYS_MMAP:
+        check_argv(args+1, 2);
+        f->eax = syscall_mmap(args[1], (void*)args[2]);
+        break;
+    case SYS_MUNMAP:
+        check_argv(args+1, 1);
+        mmap_unmap(args[1]);
+        break;
+    case SYS_MADVISE:
+        check_argv(args+1, 3);
+        f->eax = page_advise((void*)args[1], args[2], args[3]);
+        break;
+#else
+    case SYS_MADVISE:
+        //没有VM就没有可以建议的页，直接失败，不能让用户程序把内核搞崩
+        check_argv(args+1, 3);
+        f->eax = false;
+        break;
+#endif
     default:
         NOT_REACHED();
         break;
@@ -0,0 +1,478 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/page.h"
+
+/* Frame table.
+
+   Every page of user memory that backs a process's virtual
+   memory is tracked here.  Frames come from palloc's user pool.
+
+   The page cache indexes frames that hold read-only file pages
+   (executable text and read-only data) by inode number and file
+   offset.  Processes running the same executable map the same
+   cached frames instead of reading their own copies, and a
+   cached frame stays resident after its last mapper goes away so
+   that later faults, including fault-around (see page.c), can be
+   satisfied without any I/O.  Unmapped cached frames are
+   reclaimed when the user pool runs dry, and are dropped as soon
+   as the file data they hold is written or the file is
+   deleted.
+
+   When there is nothing left to reclaim, a resident page is
+   evicted.  Each process has a soft limit on its resident set
+   size (RSS), and a background thread samples the accessed bit
+   of every resident page every SCAN_TICKS timer ticks.  A page
+   that was not touched during the last scan interval is outside
+   its process's working set.  Victims are sought, in order of
+   preference, among such pages of processes over their RSS
+   limit, among such pages of any process, and finally among all
+   pages using the second-chance clock algorithm.  A process
+   that stays within its limit therefore keeps its working set
+   while another one is thrashing. */
+
+/* Ticks between working-set scans. */
+#define SCAN_TICKS (TIMER_FREQ / 4)
+
+/* All frames, in allocation order. */
+static struct list frame_list;
+
+/* Clock hand for eviction: the next frame to consider, or null
+   to start over at the front of frame_list. */
+static struct list_elem* clock_hand;
+
+/* Page cache: frames holding file pages, keyed by inode number
+   and offset. */
+static struct hash page_cache;
+
+/* Protects frame_list, clock_hand, page_cache, and the mapper
+   lists and page cache members of every frame. */
+static struct lock frame_lock;
+
+/* Statistics. */
+static long long evict_cnt;      /* # of pages evicted. */
+static long long over_limit_cnt; /* # of those from processes over their limit. */
+
+static hash_hash_func cache_hash;
+static hash_less_func cache_less;
+static void* reclaim_cached_frame(void);
+static void* evict_frame(void);
+static struct frame* pick_victim(bool* over_limit, bool* own);
+static bool lock_owner(struct page*, bool* own);
+static void add_frame(struct frame*, struct page*);
+static void remove_frame(struct frame*);
+static thread_func scan_working_sets NO_RETURN;
+
+/* Initializes the frame table and the page cache. */
+void frame_init(void) {
+  list_init(&frame_list);
+  clock_hand = NULL;
+  hash_init(&page_cache, cache_hash, cache_less, NULL);
+  lock_init(&frame_lock);
+}
+
+/* Starts the thread that periodically samples the working sets
+   of all processes.  Must be called after the scheduler and the
+   timer are running. */
+void frame_scan_start(void) { thread_create("wsscan", PRI_DEFAULT, scan_working_sets, NULL); }
+
+/* Allocates a frame from the user pool, zeroing it if PAL_ZERO
+   is set in FLAGS, and maps PAGE onto it if PAGE is non-null.
+   If the user pool is exhausted, reclaims an unmapped page cache
+   frame or, failing that, evicts a page.  Returns the new frame,
+   or a null pointer if no memory is available.  Must be called
+   with the current process's spt_lock held if it has one. */
+struct frame* frame_alloc(enum palloc_flags flags, struct page* page) {
+  struct frame* f = malloc(sizeof *f);
+  if (f == NULL)
+    return NULL;
+
+  f->kpage = palloc_get_page(PAL_USER | flags);
+  if (f->kpage == NULL) {
+    lock_acquire(&frame_lock);
+    f->kpage = reclaim_cached_frame();
+    lock_release(&frame_lock);
+    if (f->kpage == NULL)
+      f->kpage = evict_frame();
+    if (f->kpage == NULL) {
+      free(f);
+      return NULL;
+    }
+    if (flags & PAL_ZERO)
+      memset(f->kpage, 0, PGSIZE);
+  }
+
+  add_frame(f, page);
+  return f;
+}
+
+/* Like frame_alloc(), but only succeeds if the user pool has a
+   free page, never reclaiming or evicting anything.  Used for
+   speculative reads that are not worth taking memory from
+   someone else. */
+struct frame* frame_try_alloc(enum palloc_flags flags, struct page* page) {
+  struct frame* f = malloc(sizeof *f);
+  if (f == NULL)
+    return NULL;
+
+  f->kpage = palloc_get_page(PAL_USER | flags);
+  if (f->kpage == NULL) {
+    free(f);
+    return NULL;
+  }
+
+  add_frame(f, page);
+  return f;
+}
+
+/* Frees frame F, which must be neither mapped nor cached. */
+void frame_free(struct frame* f) {
+  lock_acquire(&frame_lock);
+  ASSERT(list_empty(&f->mappers));
+  ASSERT(!f->cached);
+  remove_frame(f);
+  lock_release(&frame_lock);
+
+  palloc_free_page(f->kpage);
+  free(f);
+}
+
+/* Removes PAGE from the mappers of frame F.  Frees F if that
+   was its last mapper, unless F is in the page cache. */
+void frame_unmap(struct frame* f, struct page* page) {
+  bool unused;
+
+  lock_acquire(&frame_lock);
+  list_remove(&page->frame_elem);
+  unused = list_empty(&f->mappers) && !f->cached;
+  if (unused)
+    remove_frame(f);
+  lock_release(&frame_lock);
+
+  if (unused) {
+    palloc_free_page(f->kpage);
+    free(f);
+  }
+}
+
+/* Returns true if frame F is private to the single page that
+   maps it, that is, not in the page cache. */
+bool frame_is_private(struct frame* f) {
+  bool private;
+
+  lock_acquire(&frame_lock);
+  private = !f->cached && list_size(&f->mappers) == 1;
+  lock_release(&frame_lock);
+  return private;
+}
+
+/* Looks up the page cache for the READ_BYTES bytes of INODE at
+   page-aligned offset OFS.  If found, maps PAGE onto the cached
+   frame and returns it; otherwise returns a null pointer. */
+struct frame* frame_cache_get(struct inode* inode, off_t ofs, uint32_t read_bytes,
+                              struct page* page) {
+  struct frame key;
+  struct frame* f = NULL;
+  struct hash_elem* e;
+
+  key.inumber = inode_get_inumber(inode);
+  key.ofs = ofs;
+
+  lock_acquire(&frame_lock);
+  e = hash_find(&page_cache, &key.cache_elem);
+  if (e != NULL) {
+    f = hash_entry(e, struct frame, cache_elem);
+    if (f->read_bytes == read_bytes)
+      list_push_back(&f->mappers, &page->frame_elem);
+    else
+      f = NULL;
+  }
+  lock_release(&frame_lock);
+  return f;
+}
+
+/* Adds frame F, freshly read from the READ_BYTES bytes of INODE
+   at page-aligned offset OFS, to the page cache and maps PAGE
+   onto it.  F must not be mapped yet.  If another thread cached
+   the same page first, frees F and maps PAGE onto that frame
+   instead.  Returns the frame PAGE was mapped onto. */
+struct frame* frame_cache_add(struct frame* f, struct inode* inode, off_t ofs,
+                              uint32_t read_bytes, struct page* page) {
+  struct frame* dup = NULL;
+  struct hash_elem* e;
+
+  ASSERT(list_empty(&f->mappers));
+
+  f->inumber = inode_get_inumber(inode);
+  f->ofs = ofs;
+  f->read_bytes = read_bytes;
+
+  lock_acquire(&frame_lock);
+  e = hash_insert(&page_cache, &f->cache_elem);
+  if (e == NULL)
+    f->cached = true;
+  else if (hash_entry(e, struct frame, cache_elem)->read_bytes == read_bytes) {
+    dup = f;
+    f = hash_entry(e, struct frame, cache_elem);
+    remove_frame(dup);
+  }
+  list_push_back(&f->mappers, &page->frame_elem);
+  lock_release(&frame_lock);
+
+  if (dup != NULL) {
+    palloc_free_page(dup->kpage);
+    free(dup);
+  }
+  return f;
+}
+
+/* Drops the pages of INODE that overlap the SIZE bytes starting
+   at OFS from the page cache, because their contents are about
+   to change.  Frames that are still mapped stay allocated until
+   their last mapper unmaps them. */
+void frame_cache_invalidate(struct inode* inode, off_t ofs, off_t size) {
+  struct frame key;
+  off_t end = ofs + size;
+
+  key.inumber = inode_get_inumber(inode);
+
+  lock_acquire(&frame_lock);
+  if (!hash_empty(&page_cache)) {
+    for (key.ofs = ofs - ofs % PGSIZE; key.ofs < end; key.ofs += PGSIZE) {
+      struct hash_elem* e = hash_delete(&page_cache, &key.cache_elem);
+      struct frame* f;
+
+      if (e == NULL)
+        continue;
+      f = hash_entry(e, struct frame, cache_elem);
+      f->cached = false;
+      if (list_empty(&f->mappers)) {
+        remove_frame(f);
+        palloc_free_page(f->kpage);
+        free(f);
+      }
+    }
+  }
+  lock_release(&frame_lock);
+}
+
+/* Prints eviction statistics. */
+void frame_print_stats(void) {
+  printf("Eviction: %lld pages evicted, %lld from processes over their RSS limit\n", evict_cnt,
+         over_limit_cnt);
+}
+
+/* Removes the oldest page cache frame that no process maps from
+   the cache and the frame table, and returns its kernel page for
+   reuse.  Returns a null pointer if there is no such frame.
+   Must be called with frame_lock held. */
+static void* reclaim_cached_frame(void) {
+  struct list_elem* e;
+
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+
+  for (e = list_begin(&frame_list); e != list_end(&frame_list); e = list_next(e)) {
+    struct frame* f = list_entry(e, struct frame, elem);
+    if (f->cached && list_empty(&f->mappers)) {
+      void* kpage = f->kpage;
+      hash_delete(&page_cache, &f->cache_elem);
+      remove_frame(f);
+      free(f);
+      return kpage;
+    }
+  }
+  return NULL;
+}
+
+/* Evicts a resident page and returns the kernel page of the
+   frame it occupied, or a null pointer if nothing could be
+   evicted. */
+static void* evict_frame(void) {
+  size_t tries;
+
+  lock_acquire(&frame_lock);
+  tries = list_size(&frame_list);
+  lock_release(&frame_lock);
+
+  while (tries-- > 0) {
+    struct frame* f;
+    struct page* p;
+    struct process* owner;
+    bool over_limit, own;
+    void* kpage = NULL;
+
+    lock_acquire(&frame_lock);
+    f = pick_victim(&over_limit, &own);
+    lock_release(&frame_lock);
+    if (f == NULL)
+      return NULL;
+
+    /* We hold the owner's spt_lock, so P stays on F's mapper
+       list and cannot be freed under us. */
+    p = list_entry(list_front(&f->mappers), struct page, frame_elem);
+    owner = p->pcb;
+    if (page_evict(p)) {
+      evict_cnt++;
+      if (over_limit)
+        over_limit_cnt++;
+
+      lock_acquire(&frame_lock);
+      list_remove(&p->frame_elem);
+
+      /* A page cache frame may have gained new mappers while we
+         were not holding frame_lock.  Then it stays put, and we
+         try again. */
+      if (list_empty(&f->mappers)) {
+        if (f->cached)
+          hash_delete(&page_cache, &f->cache_elem);
+        remove_frame(f);
+        kpage = f->kpage;
+        free(f);
+      }
+      lock_release(&frame_lock);
+    }
+    if (!own)
+      lock_release(&owner->spt_lock);
+
+    if (kpage != NULL)
+      return kpage;
+  }
+  return NULL;
+}
+
+/* Picks a frame to evict and returns it, with the spt_lock of
+   the process that maps it held.  Sets *OVER_LIMIT to whether
+   that process is over its RSS limit, and *OWN to whether it is
+   the current process, whose spt_lock the caller already held.
+   Returns a null pointer if no frame can be evicted.  Must be
+   called with frame_lock held. */
+static struct frame* pick_victim(bool* over_limit, bool* own) {
+  size_t frame_cnt = list_size(&frame_list);
+  int pass;
+
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+
+  /* Pass 0 looks for pages outside the working set of processes
+     over their limit, pass 1 for pages outside any working set,
+     and pass 2 runs the clock over everything, twice around so
+     that it can come back to pages whose accessed bit it
+     cleared. */
+  for (pass = 0; pass < 3; pass++) {
+    size_t n = pass < 2 ? frame_cnt : 2 * frame_cnt;
+
+    while (n-- > 0) {
+      struct frame* f;
+      struct page* p;
+      struct process* pcb;
+
+      if (clock_hand == NULL || clock_hand == list_end(&frame_list))
+        clock_hand = list_begin(&frame_list);
+      if (clock_hand == list_end(&frame_list))
+        return NULL;
+      f = list_entry(clock_hand, struct frame, elem);
+      clock_hand = list_next(clock_hand);
+
+      /* Shared page cache frames and frames still being loaded
+         are not candidates. */
+      if (list_size(&f->mappers) != 1)
+        continue;
+      p = list_entry(list_front(&f->mappers), struct page, frame_elem);
+      if (p->frame != f)
+        continue;
+
+      pcb = p->pcb;
+      *over_limit = pcb->rss_limit != 0 && pcb->rss > pcb->rss_limit;
+      if (pass == 0 && !*over_limit)
+        continue;
+      if (pass < 2 ? p->idle_scans == 0 || pagedir_is_accessed(p->pagedir, p->upage)
+                   : page_sample_accessed(p))
+        continue;
+
+      if (lock_owner(p, own)) {
+        if (p->frame == f)
+          return f;
+        if (!*own)
+          lock_release(&pcb->spt_lock);
+      }
+    }
+  }
+  return NULL;
+}
+
+/* Acquires the spt_lock of P's process without waiting, since
+   the caller holds frame_lock, and sets *OWN to true if it was
+   already held by the current thread.  Returns true if
+   successful. */
+static bool lock_owner(struct page* p, bool* own) {
+  *own = lock_held_by_current_thread(&p->pcb->spt_lock);
+  return *own || lock_try_acquire(&p->pcb->spt_lock);
+}
+
+/* Adds newly allocated frame F to the frame table, with PAGE
+   mapped onto it if PAGE is non-null. */
+static void add_frame(struct frame* f, struct page* page) {
+  lock_acquire(&frame_lock);
+  list_init(&f->mappers);
+  f->cached = false;
+  if (page != NULL)
+    list_push_back(&f->mappers, &page->frame_elem);
+  list_push_back(&frame_list, &f->elem);
+  lock_release(&frame_lock);
+}
+
+/* Removes F from the frame table, moving the clock hand past it.
+   Must be called with frame_lock held. */
+static void remove_frame(struct frame* f) {
+  if (clock_hand == &f->elem)
+    clock_hand = list_next(clock_hand);
+  list_remove(&f->elem);
+}
+
+/* Samples the accessed bits of all resident pages every
+   SCAN_TICKS ticks, to tell which pages are in their process's
+   working set. */
+static void scan_working_sets(void* aux UNUSED) {
+  for (;;) {
+    struct list_elem* e;
+
+    timer_sleep(SCAN_TICKS);
+
+    lock_acquire(&frame_lock);
+    for (e = list_begin(&frame_list); e != list_end(&frame_list); e = list_next(e)) {
+      struct frame* f = list_entry(e, struct frame, elem);
+      struct list_elem* m;
+
+      for (m = list_begin(&f->mappers); m != list_end(&f->mappers); m = list_next(m)) {
+        struct page* p = list_entry(m, struct page, frame_elem);
+        if (p->frame == f)
+          page_sample_accessed(p);
+      }
+    }
+    lock_release(&frame_lock);
+  }
+}
+
+/* Returns a hash value for page cache frame E. */
+static unsigned cache_hash(const struct hash_elem* e, void* aux UNUSED) {
+  const struct frame* f = hash_entry(e, struct frame, cache_elem);
+  return hash_int(f->inumber) ^ hash_int(f->ofs / PGSIZE);
+}
+
+/* Returns true if page cache frame A precedes frame B. */
+static bool cache_less(const struct hash_elem* a_, const struct hash_elem* b_,
+                       void* aux UNUSED) {
+  const struct frame* a = hash_entry(a_, struct frame, cache_elem);
+  const struct frame* b = hash_entry(b_, struct frame, cache_elem);
+  if (a->inumber != b->inumber)
+    return a->inumber < b->inumber;
+  return a->ofs < b->ofs;
+}
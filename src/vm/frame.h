@@ -0,0 +1,49 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+#include "threads/palloc.h"
+
+struct inode;
+struct page;
+
+/* A frame of user memory.
+
+   A frame is mapped by every page on its MAPPERS list.  Private
+   frames (stacks, data, bss) have exactly one mapper.  Frames in
+   the page cache hold a read-only file page and may be mapped by
+   any number of processes, or by none at all. */
+struct frame {
+  void* kpage;           /* Kernel virtual address of the frame. */
+  struct list mappers;   /* Pages mapping this frame. */
+  struct list_elem elem; /* Element in the frame table. */
+
+  /* Page cache. */
+  bool cached;                 /* Indexed in the page cache? */
+  block_sector_t inumber;      /* Inode number of the cached file. */
+  off_t ofs;                   /* Offset of the page in the file. */
+  uint32_t read_bytes;         /* Bytes of file data, rest is zeros. */
+  struct hash_elem cache_elem; /* Element in the page cache. */
+};
+
+void frame_init(void);
+void frame_scan_start(void);
+struct frame* frame_alloc(enum palloc_flags, struct page*);
+struct frame* frame_try_alloc(enum palloc_flags, struct page*);
+void frame_free(struct frame*);
+void frame_unmap(struct frame*, struct page*);
+bool frame_is_private(struct frame*);
+
+struct frame* frame_cache_get(struct inode*, off_t ofs, uint32_t read_bytes, struct page*);
+struct frame* frame_cache_add(struct frame*, struct inode*, off_t ofs, uint32_t read_bytes,
+                              struct page*);
+void frame_cache_invalidate(struct inode*, off_t ofs, off_t size);
+
+void frame_print_stats(void);
+
+#endif /* vm/frame.h */
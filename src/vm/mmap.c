@@ -0,0 +1,118 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "vm/page.h"
+
+/* Memory-mapped files.
+
+   mmap() only records the pages of the mapping in the process's
+   supplemental page table.  Each page is read in by the page
+   fault handler the first time it is touched, and written back
+   by page_remove() at munmap() or exit only if its dirty bit is
+   set, so a job that just reads a mapped file never copies or
+   writes anything beyond the pages it touches.
+
+   These functions must be called without file_lock held, since
+   faulting a page in takes the process's spt_lock before
+   file_lock. */
+
+static struct mmap_region* find_region(struct process*, mapid_t);
+
+/* Maps FILE into the current process starting at user virtual
+   address ADDR.  Takes ownership of FILE, which must be a
+   separate opening that nobody else closes.  Returns the new
+   mapping's identifier, or MAP_FAILED (closing FILE) if ADDR is
+   null or not page-aligned, the file is empty, any page of the
+   mapping would overlap existing pages, or memory is short. */
+mapid_t mmap_map(struct file* file, void* addr) {
+  struct process* pcb = thread_current()->pcb;
+  struct mmap_region* r;
+  off_t length;
+  size_t i;
+
+  lock_acquire(&file_lock);
+  length = file_length(file);
+  lock_release(&file_lock);
+
+  if (addr == NULL || pg_ofs(addr) != 0 || length == 0)
+    goto fail;
+
+  r = malloc(sizeof *r);
+  if (r == NULL)
+    goto fail;
+  r->file = file;
+  r->addr = addr;
+  r->page_cnt = DIV_ROUND_UP(length, PGSIZE);
+
+  for (i = 0; i < r->page_cnt; i++) {
+    uint8_t* upage = (uint8_t*)addr + i * PGSIZE;
+    off_t ofs = i * PGSIZE;
+    uint32_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+    if (!is_user_vaddr(upage) || !page_add_mmap(upage, file, ofs, read_bytes)) {
+      while (i-- > 0)
+        page_remove((uint8_t*)addr + i * PGSIZE);
+      free(r);
+      goto fail;
+    }
+  }
+
+  r->id = pcb->next_mapid++;
+  list_push_back(&pcb->mmap_list, &r->elem);
+  return r->id;
+
+fail:
+  lock_acquire(&file_lock);
+  file_close(file);
+  lock_release(&file_lock);
+  return MAP_FAILED;
+}
+
+/* Removes mapping MAPPING from the current process, writing back
+   the pages the process modified.  Does nothing if there is no
+   such mapping. */
+void mmap_unmap(mapid_t mapping) {
+  struct mmap_region* r = find_region(thread_current()->pcb, mapping);
+
+  if (r == NULL)
+    return;
+
+  page_remove_range(r->addr, r->page_cnt);
+  list_remove(&r->elem);
+  lock_acquire(&file_lock);
+  file_close(r->file);
+  lock_release(&file_lock);
+  free(r);
+}
+
+/* Frees PCB's mappings.  The pages of the mappings must already
+   have been written back and freed by page_table_destroy(). */
+void mmap_exit(struct process* pcb) {
+  while (!list_empty(&pcb->mmap_list)) {
+    struct mmap_region* r =
+        list_entry(list_pop_front(&pcb->mmap_list), struct mmap_region, elem);
+    lock_acquire(&file_lock);
+    file_close(r->file);
+    lock_release(&file_lock);
+    free(r);
+  }
+}
+
+/* Returns PCB's mapping with identifier MAPPING, or a null
+   pointer if there is none. */
+static struct mmap_region* find_region(struct process* pcb, mapid_t mapping) {
+  struct list_elem* e;
+
+  for (e = list_begin(&pcb->mmap_list); e != list_end(&pcb->mmap_list); e = list_next(e)) {
+    struct mmap_region* r = list_entry(e, struct mmap_region, elem);
+    if (r->id == mapping)
+      return r;
+  }
+  return NULL;
+}
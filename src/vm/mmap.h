@@ -0,0 +1,27 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <list.h>
+#include <stddef.h>
+
+struct file;
+struct process;
+
+/* Map region identifier. */
+typedef int mapid_t;
+#define MAP_FAILED ((mapid_t)-1)
+
+/* A memory-mapped file. */
+struct mmap_region {
+  mapid_t id;            /* Mapping identifier. */
+  struct file* file;     /* File being mapped, reopened for us. */
+  void* addr;            /* User virtual address of the first page. */
+  size_t page_cnt;       /* Number of pages mapped. */
+  struct list_elem elem; /* Element in the process's mmap_list. */
+};
+
+mapid_t mmap_map(struct file*, void* addr);
+void mmap_unmap(mapid_t);
+void mmap_exit(struct process*);
+
+#endif /* vm/mmap.h */
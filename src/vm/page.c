@@ -0,0 +1,892 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* Demand paging.
+
+   load() no longer reads a process's executable into memory up
+   front.  Instead it records each page of each segment in the
+   process's supplemental page table, and the page is read in
+   (or zero-filled) by the page fault handler the first time it
+   is touched.  Memory-mapped files (see mmap.c) work the same
+   way, except that their pages are written back to the file when
+   they are unmapped, if the process modified them.
+
+   Every fault on a read-only file page also tries to map the
+   other pages of the surrounding fault-around window, but only
+   those that are already resident in the page cache (see
+   frame.c).  Touching a binary's text sequentially then costs
+   one trap per window instead of one per page, and no extra I/O
+   is ever issued on the process's behalf.
+
+   When memory runs short, frame.c picks resident pages to evict
+   and hands them to page_evict().  A page that the process never
+   modified is simply dropped and read in again later; a dirty
+   page goes back to its file if it is memory-mapped, and to swap
+   otherwise.  A page bound for swap takes along the idle dirty
+   anonymous pages that follow it in the address space, so that
+   the whole run lands in consecutive swap slots with one disk
+   request, and faulting on any page of such a run reads in the
+   rest of it along with it while free memory lasts.
+
+   Processes can describe how they will use a range of pages
+   with page_advise().  A fault on a page marked sequential reads
+   the following READ_AHEAD_PAGES pages in from their backing
+   store, where fault-around would only map those already in
+   memory, and makes the pages well behind it the first to be
+   evicted.  A fault on a page marked random maps nothing but the
+   page itself.  Pages can also be prefetched or evicted on
+   request.
+
+   The heap has no entries in the page table until it is used.
+   Any page between the start of the heap and the break is
+   created, zero-filled, the first time it is touched, so moving
+   the break costs nothing per page.  The pages that were touched
+   are also kept on a list, so that shrinking the heap visits
+   only them.  The fault handler reads the break, so it changes
+   only with the process's spt_lock held.
+
+   Locking: file_lock, when needed, is acquired before a
+   process's spt_lock, which is acquired before frame_lock.  Code
+   that needs one of them out of order only tries to acquire
+   it. */
+
+/* Size of the fault-around window, in pages.  The window is
+   aligned to its size.  0 or 1 disables fault-around. */
+static size_t fault_around_pages;
+
+/* Number of pages read ahead of a fault on a page marked
+   sequential.  Pages more than this far behind the fault become
+   preferred eviction victims. */
+#define READ_AHEAD_PAGES 16
+
+/* Soft limit on each process's resident set, in pages, or 0 for
+   no limit. */
+static size_t default_rss_limit;
+
+/* Statistics. */
+static long long fault_around_cnt; /* # of pages mapped by fault-around. */
+static long long faults_avoided;   /* # of those the process then touched. */
+static long long clustered_cnt;    /* # of pages swapped out with a neighbor. */
+static long long read_ahead_cnt;   /* # of pages read ahead from swap. */
+static long long seq_read_cnt;     /* # of pages read ahead of sequential faults. */
+static long long drop_behind_cnt;  /* # of pages behind them marked for eviction. */
+static long long prefetch_cnt;     /* # of pages loaded by MADV_WILLNEED. */
+static long long release_cnt;      /* # of pages evicted by MADV_DONTNEED. */
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func page_destroy;
+static struct page* page_create(void* upage, enum page_type, bool writable);
+static bool add_file_page(void* upage, enum page_type, struct file*, off_t ofs,
+                          uint32_t read_bytes, bool writable);
+static bool page_insert(struct page*);
+static bool in_heap(const struct process*, const void* uaddr);
+static bool range_is_free(struct process*, uint8_t* start, uint8_t* end);
+static bool needs_file(const struct page*);
+static bool page_load(struct page*, bool speculative);
+static struct frame* load_cached(struct page*, bool speculative);
+static bool read_page(struct page*, void* kpage);
+static void write_page(struct page*, const void* kpage);
+static void page_unload(struct page*);
+static void fault_around(struct process*, struct page*);
+static void read_ahead(struct process*, struct page*);
+static bool has_backing(const struct page*);
+static size_t gather_cluster(struct page*, struct page* cluster[]);
+static void remap_page(struct page*, void* kpage);
+static void swap_in_cluster(struct page*, struct frame*);
+static bool lock_file(void);
+static void unlock_file(bool locked);
+
+/* Initializes demand paging, mapping up to FAULT_AROUND pages
+   around each file-backed fault and limiting each process's
+   resident set to RSS_LIMIT pages (0 for no limit). */
+void page_init(size_t fault_around, size_t rss_limit) {
+  fault_around_pages = fault_around;
+  default_rss_limit = rss_limit;
+}
+
+/* Initializes PCB's supplemental page table.  Returns false if
+   memory is short, in which case page_table_destroy() may still
+   be called on PCB. */
+bool page_table_init(struct process* pcb) {
+  lock_init(&pcb->spt_lock);
+  pcb->rss = 0;
+  pcb->rss_limit = default_rss_limit;
+  list_init(&pcb->heap_pages);
+  return hash_init(&pcb->spt, page_hash, page_less, NULL);
+}
+
+/* Unmaps and frees every page in PCB's supplemental page table,
+   along with the table itself.  PCB's page directory must not
+   be active on any thread. */
+void page_table_destroy(struct process* pcb) {
+  bool locked;
+
+  if (pcb->spt.buckets == NULL)
+    return;
+
+  locked = lock_file();
+  lock_acquire(&pcb->spt_lock);
+  hash_destroy(&pcb->spt, page_destroy);
+  lock_release(&pcb->spt_lock);
+  unlock_file(locked);
+}
+
+/* Adds a page at user virtual address UPAGE to the current
+   process that is loaded on demand from the READ_BYTES bytes of
+   FILE at offset OFS, followed by zeros.  Returns false if UPAGE
+   is already part of the address space or memory is short. */
+bool page_add_file(void* upage, struct file* file, off_t ofs, uint32_t read_bytes,
+                   bool writable) {
+  return add_file_page(upage, PAGE_FILE, file, ofs, read_bytes, writable);
+}
+
+/* Adds a page at user virtual address UPAGE to the current
+   process that maps the READ_BYTES bytes of FILE at offset OFS,
+   followed by zeros.  The page is writable, and if it is dirty
+   when it is unmapped, its file bytes are written back to FILE.
+   Returns false if UPAGE is already part of the address space or
+   memory is short. */
+bool page_add_mmap(void* upage, struct file* file, off_t ofs, uint32_t read_bytes) {
+  return add_file_page(upage, PAGE_MMAP, file, ofs, read_bytes, true);
+}
+
+/* Adds a zero-filled page at user virtual address UPAGE to the
+   current process.  Returns false if UPAGE is already part of
+   the address space or memory is short. */
+bool page_add_zero(void* upage, bool writable) {
+  struct page* p = page_create(upage, PAGE_ZERO, writable);
+  return p != NULL && page_insert(p);
+}
+
+/* Removes the page at user virtual address UPAGE from the
+   current process's address space, writing it back first if it
+   is a dirty memory-mapped page.  Does nothing if there is no
+   page at UPAGE. */
+void page_remove(void* upage) { page_remove_range(upage, 1); }
+
+/* Removes the PAGE_CNT pages starting at user virtual address
+   UPAGE from the current process's address space, as if by
+   page_remove(), but invalidates the TLB only once for the whole
+   range.  Pages that do not exist are skipped. */
+void page_remove_range(void* upage, size_t page_cnt) {
+  struct process* pcb = thread_current()->pcb;
+  bool locked;
+  size_t i;
+
+  locked = lock_file();
+  lock_acquire(&pcb->spt_lock);
+
+  /* Clearing the PTEs keeps their dirty bits, which
+     page_unload() checks.  Holding spt_lock from here on keeps
+     another thread from faulting on a cleared page before it is
+     gone from the page table. */
+  pagedir_clear_range(pcb->pagedir, upage, page_cnt);
+  for (i = 0; i < page_cnt; i++) {
+    struct page* p = page_lookup(pcb, (uint8_t*)upage + i * PGSIZE);
+    if (p != NULL) {
+      hash_delete(&pcb->spt, &p->hash_elem);
+      page_unload(p);
+      free(p);
+    }
+  }
+  lock_release(&pcb->spt_lock);
+  unlock_file(locked);
+}
+
+/* Moves the current process's break to NEW_END, which the
+   caller has checked lies between the start of the heap and its
+   limit.  Pages the heap gains are created when they are first
+   touched, and of the pages it loses only those that were
+   touched are removed.  Returns false, leaving the heap
+   unchanged, if the heap would grow over other pages.  Must be
+   called with the process's heap_lock held. */
+bool page_set_break(void* new_end) {
+  struct process* pcb = thread_current()->pcb;
+  uint8_t* old_top = pg_round_up(pcb->heap_end);
+  uint8_t* new_top = pg_round_up(new_end);
+  bool locked = false;
+  bool success = true;
+
+  ASSERT(lock_held_by_current_thread(&pcb->heap_lock));
+
+  if (new_top < old_top)
+    locked = lock_file();
+  lock_acquire(&pcb->spt_lock);
+  if (new_top > old_top)
+    success = range_is_free(pcb, old_top, new_top);
+  else if (new_top < old_top) {
+    struct list_elem* e = list_begin(&pcb->heap_pages);
+    while (e != list_end(&pcb->heap_pages)) {
+      struct page* p = list_entry(e, struct page, heap_elem);
+      e = list_next(e);
+      if ((uint8_t*)p->upage >= new_top) {
+        list_remove(&p->heap_elem);
+        hash_delete(&pcb->spt, &p->hash_elem);
+        page_unload(p);
+        free(p);
+      }
+    }
+  }
+  if (success)
+    pcb->heap_end = new_end;
+  lock_release(&pcb->spt_lock);
+  unlock_file(locked);
+  return success;
+}
+
+/* Returns the page containing user virtual address UADDR in
+   PCB's address space, or a null pointer if there is none.
+   Must be called with PCB's spt_lock held. */
+struct page* page_lookup(struct process* pcb, const void* uaddr) {
+  struct page key;
+  struct hash_elem* e;
+
+  key.upage = pg_round_down(uaddr);
+  e = hash_find(&pcb->spt, &key.hash_elem);
+  return e != NULL ? hash_entry(e, struct page, hash_elem) : NULL;
+}
+
+/* Makes the page containing UADDR in the current process
+   resident, reading it in if necessary.  Returns false if UADDR
+   is not part of the process's address space, if WRITE is true
+   but the page is read-only, or if the page cannot be loaded. */
+bool page_fault_in(const void* uaddr, bool write) {
+  struct process* pcb = thread_current()->pcb;
+  bool locked = false;
+  struct page* p;
+  bool success = false;
+
+  if (pcb == NULL || pcb->pagedir == NULL || !is_user_vaddr(uaddr))
+    return false;
+
+  lock_acquire(&pcb->spt_lock);
+  p = page_lookup(pcb, uaddr);
+  if (p != NULL && (needs_file(p) || p->advice == MADV_SEQUENTIAL) &&
+      !lock_held_by_current_thread(&file_lock)) {
+    /* Reading the page or its read-ahead window in takes
+       file_lock, which has to be acquired before spt_lock. */
+    lock_release(&pcb->spt_lock);
+    locked = lock_file();
+    lock_acquire(&pcb->spt_lock);
+    p = page_lookup(pcb, uaddr);
+  }
+
+  if (p == NULL && in_heap(pcb, uaddr)) {
+    /* First touch of a heap page. */
+    p = page_create(pg_round_down(uaddr), PAGE_ZERO, true);
+    if (p != NULL) {
+      hash_insert(&pcb->spt, &p->hash_elem);
+      list_push_back(&pcb->heap_pages, &p->heap_elem);
+    }
+  }
+
+  if (p != NULL && (p->writable || !write)) {
+    if (p->frame != NULL)
+      success = true;
+    else if (page_load(p, false)) {
+      success = true;
+      if (p->advice == MADV_SEQUENTIAL)
+        read_ahead(pcb, p);
+      else if (p->advice != MADV_RANDOM && p->type == PAGE_FILE && !p->writable)
+        fault_around(pcb, p);
+    }
+  }
+  lock_release(&pcb->spt_lock);
+  unlock_file(locked);
+  return success;
+}
+
+/* Applies ADVICE, one of the MADV_* constants, to the pages of
+   the current process in the LENGTH bytes starting at ADDR,
+   which must be page-aligned.  MADV_NORMAL, MADV_SEQUENTIAL, and
+   MADV_RANDOM set how later faults on the pages are handled.
+   MADV_WILLNEED reads in the pages that are not resident, as far
+   as free memory allows.  MADV_DONTNEED evicts the resident
+   pages, writing them back first if they are dirty, so their
+   contents are preserved.  Heap pages that were never touched
+   are left alone.  Returns false if the arguments are invalid or
+   part of the range is not mapped. */
+bool page_advise(void* addr, size_t length, int advice) {
+  struct process* pcb = thread_current()->pcb;
+  uint8_t* upage = addr;
+  uint8_t* end = upage + length;
+  bool locked = false;
+  bool success = true;
+
+  if (pg_ofs(addr) != 0 || advice < MADV_NORMAL || advice > MADV_DONTNEED)
+    return false;
+  if (length == 0)
+    return true;
+  if (end < upage || !is_user_vaddr(end - 1))
+    return false;
+
+  /* Prefetching and evicting may use files. */
+  if (advice == MADV_WILLNEED || advice == MADV_DONTNEED)
+    locked = lock_file();
+  lock_acquire(&pcb->spt_lock);
+  for (; upage < end; upage += PGSIZE) {
+    struct page* p = page_lookup(pcb, upage);
+    struct frame* f;
+
+    if (p == NULL) {
+      if (!in_heap(pcb, upage))
+        success = false;
+      continue;
+    }
+    switch (advice) {
+      case MADV_WILLNEED:
+        if (p->frame == NULL && has_backing(p) && page_load(p, true))
+          prefetch_cnt++;
+        break;
+      case MADV_DONTNEED:
+        f = p->frame;
+        if (f != NULL && page_evict(p)) {
+          frame_unmap(f, p);
+          release_cnt++;
+        }
+        break;
+      default:
+        p->advice = advice;
+        break;
+    }
+  }
+  lock_release(&pcb->spt_lock);
+  unlock_file(locked);
+  return success;
+}
+
+/* Returns true if resident page P was accessed since the last
+   time this function was called on it, clearing its accessed
+   bit, and otherwise adds one to P's count of idle working-set
+   scans.  Must be called with frame_lock held. */
+bool page_sample_accessed(struct page* p) {
+  if (!pagedir_is_accessed(p->pagedir, p->upage)) {
+    if (p->idle_scans < UINT8_MAX)
+      p->idle_scans++;
+    return false;
+  }
+
+  if (p->prefaulted) {
+    faults_avoided++;
+    p->prefaulted = false;
+  }
+  pagedir_set_accessed(p->pagedir, p->upage, false);
+  p->idle_scans = 0;
+  return true;
+}
+
+/* Evicts resident page P from its frame, first writing it back
+   to its file or to swap if the process modified it.  Afterward
+   P no longer refers to the frame, but the caller must still
+   take P off the frame's mapper list.  Returns false, leaving P
+   resident, if P had to go to swap but swap is full.  Must be
+   called with P's process's spt_lock held. */
+bool page_evict(struct page* p) {
+  void* kpage = p->frame->kpage;
+  bool to_swap;
+
+  /* Unmap P first so that the process cannot modify it while it
+     is being written.  Unmapping preserves the dirty bit. */
+  pagedir_clear_page(p->pagedir, p->upage);
+  to_swap = pagedir_is_dirty(p->pagedir, p->upage);
+
+  /* A dirty memory-mapped page goes back to its file, unless
+     that means waiting for file_lock out of order. */
+  if (to_swap && p->type == PAGE_MMAP) {
+    if (lock_held_by_current_thread(&file_lock)) {
+      write_page(p, kpage);
+      to_swap = false;
+    } else if (lock_try_acquire(&file_lock)) {
+      write_page(p, kpage);
+      lock_release(&file_lock);
+      to_swap = false;
+    }
+  }
+
+  if (to_swap) {
+    struct page* cluster[SWAP_CLUSTER];
+    void* kpages[SWAP_CLUSTER];
+    size_t cnt = gather_cluster(p, cluster);
+    size_t slot;
+    size_t i;
+
+    for (i = 0; i < cnt; i++)
+      kpages[i] = cluster[i]->frame->kpage;
+    slot = swap_out(kpages, cnt);
+    if (slot == SWAP_NONE && cnt > 1) {
+      /* No run of free slots is long enough.  Send P alone. */
+      for (i = 1; i < cnt; i++)
+        remap_page(cluster[i], kpages[i]);
+      cnt = 1;
+      slot = swap_out(kpages, cnt);
+    }
+    if (slot == SWAP_NONE) {
+      remap_page(p, kpage);
+      return false;
+    }
+    p->swap_slot = slot;
+
+    for (i = 1; i < cnt; i++) {
+      struct page* q = cluster[i];
+      struct frame* f = q->frame;
+
+      q->swap_slot = slot + i;
+      q->frame = NULL;
+      q->pcb->rss--;
+      frame_unmap(f, q);
+      clustered_cnt++;
+    }
+  }
+
+  if (p->prefaulted && pagedir_is_accessed(p->pagedir, p->upage))
+    faults_avoided++;
+  p->prefaulted = false;
+  p->frame = NULL;
+  p->pcb->rss--;
+  return true;
+}
+
+/* Prints demand paging statistics. */
+void page_print_stats(void) {
+  printf("Fault-around: %lld pages mapped, %lld faults avoided\n", fault_around_cnt,
+         faults_avoided);
+  printf("Advice: %lld pages read ahead, %lld dropped behind, %lld prefetched, %lld released\n",
+         seq_read_cnt, drop_behind_cnt, prefetch_cnt, release_cnt);
+  printf("Swap clustering: %lld pages evicted with a neighbor, %lld pages read ahead\n",
+         clustered_cnt, read_ahead_cnt);
+}
+
+/* Allocates a new page of the given TYPE for user virtual
+   address UPAGE in the current process.  The page is not yet
+   part of the supplemental page table. */
+static struct page* page_create(void* upage, enum page_type type, bool writable) {
+  struct page* p;
+
+  ASSERT(pg_ofs(upage) == 0);
+  ASSERT(is_user_vaddr(upage));
+
+  p = malloc(sizeof *p);
+  if (p != NULL) {
+    p->upage = upage;
+    p->pcb = thread_current()->pcb;
+    p->pagedir = p->pcb->pagedir;
+    p->frame = NULL;
+    p->type = type;
+    p->writable = writable;
+    p->prefaulted = false;
+    p->swap_slot = SWAP_NONE;
+    p->idle_scans = 0;
+    p->advice = MADV_NORMAL;
+    p->file = NULL;
+    p->file_ofs = 0;
+    p->read_bytes = 0;
+  }
+  return p;
+}
+
+/* Creates a page of TYPE PAGE_FILE or PAGE_MMAP for UPAGE and
+   inserts it into the current process's supplemental page table.
+   See page_add_file() for the meaning of the other arguments. */
+static bool add_file_page(void* upage, enum page_type type, struct file* file, off_t ofs,
+                          uint32_t read_bytes, bool writable) {
+  struct page* p;
+
+  ASSERT(ofs % PGSIZE == 0);
+  ASSERT(read_bytes <= PGSIZE);
+
+  p = page_create(upage, type, writable);
+  if (p == NULL)
+    return false;
+  p->file = file;
+  p->file_ofs = ofs;
+  p->read_bytes = read_bytes;
+  return page_insert(p);
+}
+
+/* Inserts P into the current process's supplemental page table.
+   Frees P and returns false if its address is already taken,
+   including by the heap. */
+static bool page_insert(struct page* p) {
+  struct process* pcb = thread_current()->pcb;
+  bool success;
+
+  lock_acquire(&pcb->spt_lock);
+  success = !in_heap(pcb, p->upage) && hash_insert(&pcb->spt, &p->hash_elem) == NULL;
+  lock_release(&pcb->spt_lock);
+
+  if (!success)
+    free(p);
+  return success;
+}
+
+/* Returns true if UADDR lies in a page of PCB's heap, whether or
+   not the page has been touched.  Must be called with PCB's
+   spt_lock held. */
+static bool in_heap(const struct process* pcb, const void* uaddr) {
+  return (const uint8_t*)uaddr >= pcb->heap_start &&
+         (const uint8_t*)uaddr < (const uint8_t*)pg_round_up(pcb->heap_end);
+}
+
+/* Returns true if none of PCB's pages lies between page-aligned
+   START and END.  Looks up each page of the range, or scans the
+   page table instead if it has fewer entries.  Must be called
+   with PCB's spt_lock held. */
+static bool range_is_free(struct process* pcb, uint8_t* start, uint8_t* end) {
+  struct hash_iterator i;
+
+  if ((size_t)(end - start) / PGSIZE <= hash_size(&pcb->spt)) {
+    for (; start < end; start += PGSIZE)
+      if (page_lookup(pcb, start) != NULL)
+        return false;
+    return true;
+  }
+
+  hash_first(&i, &pcb->spt);
+  while (hash_next(&i)) {
+    struct page* p = hash_entry(hash_cur(&i), struct page, hash_elem);
+    if ((uint8_t*)p->upage >= start && (uint8_t*)p->upage < end)
+      return false;
+  }
+  return true;
+}
+
+/* Returns true if faulting in P may have to read its file. */
+static bool needs_file(const struct page* p) {
+  return p->frame == NULL && p->swap_slot == SWAP_NONE && p->type != PAGE_ZERO;
+}
+
+/* Returns true if P's contents live somewhere other than memory,
+   that is, in swap or in a file. */
+static bool has_backing(const struct page* p) {
+  return p->swap_slot != SWAP_NONE || p->type != PAGE_ZERO;
+}
+
+/* Reads P in from swap, its file, or zeros into a frame and maps
+   it.  If SPECULATIVE, uses only free memory, without reclaiming
+   or evicting anything.  Must be called with P's process's
+   spt_lock held, and with file_lock held if needs_file(P). */
+static bool page_load(struct page* p, bool speculative) {
+  struct frame* f;
+
+  ASSERT(p->frame == NULL);
+
+  if (p->swap_slot != SWAP_NONE) {
+    f = speculative ? frame_try_alloc(0, p) : frame_alloc(0, p);
+    if (f != NULL)
+      swap_in_cluster(p, f);
+  } else if (p->type == PAGE_ZERO)
+    f = speculative ? frame_try_alloc(PAL_ZERO, p) : frame_alloc(PAL_ZERO, p);
+  else if (p->type == PAGE_FILE && !p->writable)
+    f = load_cached(p, speculative);
+  else {
+    f = speculative ? frame_try_alloc(0, p) : frame_alloc(0, p);
+    if (f != NULL && !read_page(p, f->kpage)) {
+      frame_unmap(f, p);
+      f = NULL;
+    }
+  }
+  if (f == NULL)
+    return false;
+
+  if (!pagedir_set_page(p->pagedir, p->upage, f->kpage, p->writable)) {
+    frame_unmap(f, p);
+    return false;
+  }
+  if (p->swap_slot != SWAP_NONE) {
+    /* The swap slot is gone, so the page must be written out
+       again if it is evicted, even if it is not modified. */
+    swap_free(p->swap_slot);
+    p->swap_slot = SWAP_NONE;
+    pagedir_set_dirty(p->pagedir, p->upage, true);
+  }
+  p->frame = f;
+  p->idle_scans = 0;
+  p->pcb->rss++;
+  return true;
+}
+
+/* Returns a page cache frame holding read-only file page P,
+   reading it in if it is not cached yet, with P mapped onto
+   it.  See page_load() for SPECULATIVE.  Returns a null pointer
+   on failure. */
+static struct frame* load_cached(struct page* p, bool speculative) {
+  struct inode* inode = file_get_inode(p->file);
+  struct frame* f;
+
+  f = frame_cache_get(inode, p->file_ofs, p->read_bytes, p);
+  if (f != NULL)
+    return f;
+
+  f = speculative ? frame_try_alloc(0, NULL) : frame_alloc(0, NULL);
+  if (f == NULL)
+    return NULL;
+  if (!read_page(p, f->kpage)) {
+    frame_free(f);
+    return NULL;
+  }
+  return frame_cache_add(f, inode, p->file_ofs, p->read_bytes, p);
+}
+
+/* Reads the file contents of P into KPAGE and zeros the rest of
+   the page.  Returns true if all the bytes could be read.  Must
+   be called with file_lock held. */
+static bool read_page(struct page* p, void* kpage) {
+  off_t bytes_read;
+
+  ASSERT(lock_held_by_current_thread(&file_lock));
+
+  bytes_read = file_read_at(p->file, kpage, p->read_bytes, p->file_ofs);
+  memset((uint8_t*)kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+  return bytes_read == (off_t)p->read_bytes;
+}
+
+/* Writes the file bytes of memory-mapped page P, whose contents
+   are at KPAGE, back to its file.  Must be called with file_lock
+   held. */
+static void write_page(struct page* p, const void* kpage) {
+  ASSERT(lock_held_by_current_thread(&file_lock));
+
+  file_write_at(p->file, kpage, p->read_bytes, p->file_ofs);
+}
+
+/* Maps the pages in the fault-around window of P, which was just
+   faulted in, whose contents are already in the page cache.
+   Must be called with PCB's spt_lock held. */
+static void fault_around(struct process* pcb, struct page* p) {
+  uintptr_t first, pg;
+
+  if (fault_around_pages < 2)
+    return;
+
+  first = pg_no(p->upage) - pg_no(p->upage) % fault_around_pages;
+  for (pg = first; pg < first + fault_around_pages; pg++) {
+    void* upage = (void*)(pg << PGBITS);
+    struct page* q;
+    struct frame* f;
+
+    if (!is_user_vaddr(upage))
+      break;
+    q = page_lookup(pcb, upage);
+    if (q == NULL || q->frame != NULL || q->type != PAGE_FILE || q->writable)
+      continue;
+
+    f = frame_cache_get(file_get_inode(q->file), q->file_ofs, q->read_bytes, q);
+    if (f == NULL)
+      continue;
+    if (!pagedir_set_page(q->pagedir, q->upage, f->kpage, false)) {
+      frame_unmap(f, q);
+      break;
+    }
+    q->frame = f;
+    q->prefaulted = true;
+    q->idle_scans = 0;
+    pcb->rss++;
+    fault_around_cnt++;
+  }
+}
+
+/* Reads in the READ_AHEAD_PAGES pages after P, which was just
+   faulted in and is marked sequential, as far as free memory
+   allows.  The process is not expected to return to pages it
+   has left behind, so those between READ_AHEAD_PAGES and three
+   times as many pages behind P are made to look idle, which
+   makes them the first candidates for eviction unless the
+   process touches them again.  Must be called with PCB's
+   spt_lock held. */
+static void read_ahead(struct process* pcb, struct page* p) {
+  uintptr_t pg = pg_no(p->upage);
+  uintptr_t i;
+
+  for (i = 1; i <= READ_AHEAD_PAGES; i++) {
+    void* upage = (void*)((pg + i) << PGBITS);
+    struct page* q;
+
+    if (!is_user_vaddr(upage))
+      break;
+    q = page_lookup(pcb, upage);
+    if (q == NULL)
+      break;
+    if (q->frame != NULL || !has_backing(q))
+      continue;
+    if (needs_file(q) && !lock_held_by_current_thread(&file_lock))
+      break;
+    if (!page_load(q, true))
+      break;
+    seq_read_cnt++;
+  }
+
+  for (i = READ_AHEAD_PAGES + 1; i <= 3 * READ_AHEAD_PAGES && i <= pg; i++) {
+    struct page* q = page_lookup(pcb, (void*)((pg - i) << PGBITS));
+
+    if (q != NULL && q->frame != NULL && q->advice == MADV_SEQUENTIAL && q->idle_scans == 0) {
+      pagedir_set_accessed(q->pagedir, q->upage, false);
+      q->idle_scans = 1;
+      drop_behind_cnt++;
+    }
+  }
+}
+
+/* Stores P, whose page is about to go to swap, into CLUSTER[0],
+   followed by the run of pages after it that can go along: those
+   that are resident in private frames, anonymous, dirty, and
+   outside the working set.  Unmaps the pages it adds, so that the
+   process cannot modify them while they are written.  Returns
+   the number of pages stored.  Must be called with P's process's
+   spt_lock held. */
+static size_t gather_cluster(struct page* p, struct page* cluster[]) {
+  size_t cnt = 1;
+
+  cluster[0] = p;
+  while (cnt < SWAP_CLUSTER) {
+    void* upage = (uint8_t*)p->upage + cnt * PGSIZE;
+    struct page* q;
+
+    if (!is_user_vaddr(upage))
+      break;
+    q = page_lookup(p->pcb, upage);
+    if (q == NULL || q->frame == NULL || q->type == PAGE_MMAP || q->idle_scans == 0 ||
+        pagedir_is_accessed(q->pagedir, upage) || !pagedir_is_dirty(q->pagedir, upage) ||
+        !frame_is_private(q->frame))
+      break;
+
+    pagedir_clear_page(q->pagedir, upage);
+    cluster[cnt++] = q;
+  }
+  return cnt;
+}
+
+/* Maps P, which was unmapped for eviction, back onto KPAGE. */
+static void remap_page(struct page* p, void* kpage) {
+  pagedir_set_page(p->pagedir, p->upage, kpage, p->writable);
+  pagedir_set_dirty(p->pagedir, p->upage, true);
+}
+
+/* Reads P, which is in swap, into frame F.  Pages following P
+   whose slots follow P's slot were most likely swapped out in
+   the same cluster, so as many of them as fit in free frames are
+   read in by the same request and mapped.  Must be called with
+   P's process's spt_lock held. */
+static void swap_in_cluster(struct page* p, struct frame* f) {
+  struct page* cluster[SWAP_CLUSTER];
+  struct frame* frames[SWAP_CLUSTER];
+  void* kpages[SWAP_CLUSTER];
+  size_t cnt, i;
+
+  kpages[0] = f->kpage;
+  for (cnt = 1; cnt < SWAP_CLUSTER; cnt++) {
+    void* upage = (uint8_t*)p->upage + cnt * PGSIZE;
+    struct page* q;
+
+    if (!is_user_vaddr(upage))
+      break;
+    q = page_lookup(p->pcb, upage);
+    if (p->advice == MADV_RANDOM || q == NULL || q->frame != NULL ||
+        q->swap_slot != p->swap_slot + cnt)
+      break;
+    frames[cnt] = frame_try_alloc(0, q);
+    if (frames[cnt] == NULL)
+      break;
+    cluster[cnt] = q;
+    kpages[cnt] = frames[cnt]->kpage;
+  }
+
+  swap_in(p->swap_slot, kpages, cnt);
+
+  for (i = 1; i < cnt; i++) {
+    struct page* q = cluster[i];
+
+    if (!pagedir_set_page(q->pagedir, q->upage, kpages[i], q->writable)) {
+      frame_unmap(frames[i], q);
+      continue;
+    }
+    swap_free(q->swap_slot);
+    q->swap_slot = SWAP_NONE;
+    pagedir_set_dirty(q->pagedir, q->upage, true);
+    q->frame = frames[i];
+    q->idle_scans = 0;
+    q->pcb->rss++;
+    read_ahead_cnt++;
+  }
+}
+
+/* Releases whatever page P holds: its frame, after writing it
+   back if it is a dirty memory-mapped page, or its swap slot.
+   Counts prefaulted pages that the process went on to use as
+   faults avoided.  Must be called with file_lock and P's
+   process's spt_lock held. */
+static void page_unload(struct page* p) {
+  if (p->frame != NULL) {
+    if (p->type == PAGE_MMAP && pagedir_is_dirty(p->pagedir, p->upage))
+      write_page(p, p->frame->kpage);
+    if (p->prefaulted && pagedir_is_accessed(p->pagedir, p->upage))
+      faults_avoided++;
+    pagedir_clear_page(p->pagedir, p->upage);
+    frame_unmap(p->frame, p);
+    p->frame = NULL;
+    p->pcb->rss--;
+  } else if (p->swap_slot != SWAP_NONE) {
+    /* A memory-mapped page in swap was dirty when it was
+       evicted, so it has to reach its file through a bounce
+       buffer. */
+    if (p->type == PAGE_MMAP) {
+      void* kpage = palloc_get_page(0);
+      if (kpage != NULL) {
+        swap_in(p->swap_slot, &kpage, 1);
+        write_page(p, kpage);
+        palloc_free_page(kpage);
+      }
+    }
+    swap_free(p->swap_slot);
+    p->swap_slot = SWAP_NONE;
+  }
+}
+
+/* Unmaps and frees page E. */
+static void page_destroy(struct hash_elem* e, void* aux UNUSED) {
+  struct page* p = hash_entry(e, struct page, hash_elem);
+
+  page_unload(p);
+  free(p);
+}
+
+/* Acquires file_lock unless the current thread already holds it.
+   Returns true if it had to be acquired. */
+static bool lock_file(void) {
+  if (lock_held_by_current_thread(&file_lock))
+    return false;
+  lock_acquire(&file_lock);
+  return true;
+}
+
+/* Releases file_lock if LOCKED, as returned by lock_file(). */
+static void unlock_file(bool locked) {
+  if (locked)
+    lock_release(&file_lock);
+}
+
+/* Returns a hash value for page E. */
+static unsigned page_hash(const struct hash_elem* e, void* aux UNUSED) {
+  const struct page* p = hash_entry(e, struct page, hash_elem);
+  return hash_int(pg_no(p->upage));
+}
+
+/* Returns true if page A precedes page B. */
+static bool page_less(const struct hash_elem* a_, const struct hash_elem* b_, void* aux UNUSED) {
+  const struct page* a = hash_entry(a_, struct page, hash_elem);
+  const struct page* b = hash_entry(b_, struct page, hash_elem);
+  return a->upage < b->upage;
+}
@@ -0,0 +1,71 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct process;
+
+/* Advice for page_advise(), as passed to the madvise system
+   call. */
+#define MADV_NORMAL 0     /* No special treatment. */
+#define MADV_SEQUENTIAL 1 /* Expect sequential access. */
+#define MADV_RANDOM 2     /* Expect random access. */
+#define MADV_WILLNEED 3   /* Expect access soon. */
+#define MADV_DONTNEED 4   /* Do not expect access soon. */
+
+/* Where the contents of a page come from when it is faulted in. */
+enum page_type {
+  PAGE_FILE, /* Read from a file, zero-padded to a full page. */
+  PAGE_MMAP, /* Like PAGE_FILE, but written back to the file. */
+  PAGE_ZERO  /* Zero-filled. */
+};
+
+/* A page of a process's virtual address space, that is, an
+   entry in its supplemental page table. */
+struct page {
+  void* upage;          /* User virtual address. */
+  struct process* pcb;  /* Owning process. */
+  uint32_t* pagedir;    /* Page directory UPAGE is mapped in. */
+  struct frame* frame;  /* Frame holding the page, or null. */
+  enum page_type type;  /* Backing store. */
+  bool writable;        /* Writable by the process? */
+  bool prefaulted;      /* Mapped by fault-around rather than a fault? */
+  size_t swap_slot;     /* Swap slot holding the page, or SWAP_NONE. */
+  uint8_t idle_scans;   /* Working-set scans since last access. */
+  uint8_t advice;       /* MADV_NORMAL, MADV_SEQUENTIAL, or MADV_RANDOM. */
+
+  /* PAGE_FILE and PAGE_MMAP only. */
+  struct file* file;   /* File to read from. */
+  off_t file_ofs;      /* Page-aligned offset in FILE. */
+  uint32_t read_bytes; /* Bytes to read; the rest is zeroed. */
+
+  struct hash_elem hash_elem;  /* Element in the process's page table. */
+  struct list_elem frame_elem; /* Element in FRAME's mapper list. */
+  struct list_elem heap_elem;  /* Element in the heap_pages list, for heap pages. */
+};
+
+void page_init(size_t fault_around_pages, size_t rss_limit);
+bool page_table_init(struct process*);
+void page_table_destroy(struct process*);
+
+bool page_add_file(void* upage, struct file*, off_t ofs, uint32_t read_bytes, bool writable);
+bool page_add_mmap(void* upage, struct file*, off_t ofs, uint32_t read_bytes);
+bool page_add_zero(void* upage, bool writable);
+void page_remove(void* upage);
+void page_remove_range(void* upage, size_t page_cnt);
+bool page_set_break(void* new_end);
+struct page* page_lookup(struct process*, const void* uaddr);
+bool page_fault_in(const void* uaddr, bool write);
+bool page_advise(void* addr, size_t length, int advice);
+
+bool page_sample_accessed(struct page*);
+bool page_evict(struct page*);
+
+void page_print_stats(void);
+
+#endif /* vm/page.h */
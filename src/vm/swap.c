@@ -0,0 +1,130 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap space.
+
+   The swap block device is divided into page-size slots.  A
+   page that has to be evicted but cannot be re-read from a file
+   is written to a free slot, and read back (freeing the slot)
+   when the process faults on it again.
+
+   Pages are moved in clusters of up to SWAP_CLUSTER pages that
+   occupy consecutive slots, so that evicting or faulting in a
+   run of neighboring pages costs one multi-sector disk request
+   instead of one request per sector.  Clusters are staged in a
+   contiguous bounce buffer, because the frames themselves are
+   scattered through physical memory. */
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Swap device, or a null pointer if there is none. */
+static struct block* swap_device;
+
+/* Bitmap of used swap slots. */
+static struct bitmap* used_slots;
+
+/* Protects used_slots. */
+static struct lock swap_lock;
+
+/* Bounce buffer of SWAP_CLUSTER pages, protected by
+   cluster_lock. */
+static uint8_t* cluster_buf;
+static struct lock cluster_lock;
+
+/* Statistics. */
+static long long out_cnt;     /* # of pages written to swap. */
+static long long in_cnt;      /* # of pages read from swap. */
+static long long out_req_cnt; /* # of write requests. */
+static long long in_req_cnt;  /* # of read requests. */
+
+/* Initializes the swap space.  Without a swap device, every
+   swap_out() fails. */
+void swap_init(void) {
+  lock_init(&swap_lock);
+  lock_init(&cluster_lock);
+  swap_device = block_get_role(BLOCK_SWAP);
+  if (swap_device == NULL)
+    return;
+
+  used_slots = bitmap_create(block_size(swap_device) / PAGE_SECTORS);
+  if (used_slots == NULL)
+    PANIC("swap bitmap creation failed");
+  cluster_buf = palloc_get_multiple(PAL_ASSERT, SWAP_CLUSTER);
+}
+
+/* Writes the CNT pages at KPAGES[] to CNT consecutive free swap
+   slots in a single request.  Returns the first slot, which
+   holds KPAGES[0], or SWAP_NONE if no run of CNT free slots is
+   available. */
+size_t swap_out(void* const kpages[], size_t cnt) {
+  size_t slot;
+  size_t i;
+
+  ASSERT(cnt >= 1 && cnt <= SWAP_CLUSTER);
+
+  if (swap_device == NULL)
+    return SWAP_NONE;
+
+  lock_acquire(&swap_lock);
+  slot = bitmap_scan_and_flip(used_slots, 0, cnt, false);
+  lock_release(&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return SWAP_NONE;
+
+  if (cnt == 1)
+    block_write_multiple(swap_device, slot * PAGE_SECTORS, PAGE_SECTORS, kpages[0]);
+  else {
+    lock_acquire(&cluster_lock);
+    for (i = 0; i < cnt; i++)
+      memcpy(cluster_buf + i * PGSIZE, kpages[i], PGSIZE);
+    block_write_multiple(swap_device, slot * PAGE_SECTORS, cnt * PAGE_SECTORS, cluster_buf);
+    lock_release(&cluster_lock);
+  }
+  out_cnt += cnt;
+  out_req_cnt++;
+  return slot;
+}
+
+/* Reads the CNT consecutive swap slots starting at SLOT into the
+   pages at KPAGES[] in a single request.  The slots stay
+   allocated. */
+void swap_in(size_t slot, void* const kpages[], size_t cnt) {
+  size_t i;
+
+  ASSERT(cnt >= 1 && cnt <= SWAP_CLUSTER);
+  ASSERT(bitmap_all(used_slots, slot, cnt));
+
+  if (cnt == 1)
+    block_read_multiple(swap_device, slot * PAGE_SECTORS, PAGE_SECTORS, kpages[0]);
+  else {
+    lock_acquire(&cluster_lock);
+    block_read_multiple(swap_device, slot * PAGE_SECTORS, cnt * PAGE_SECTORS, cluster_buf);
+    for (i = 0; i < cnt; i++)
+      memcpy(kpages[i], cluster_buf + i * PGSIZE, PGSIZE);
+    lock_release(&cluster_lock);
+  }
+  in_cnt += cnt;
+  in_req_cnt++;
+}
+
+/* Marks swap slot SLOT free. */
+void swap_free(size_t slot) {
+  lock_acquire(&swap_lock);
+  ASSERT(bitmap_test(used_slots, slot));
+  bitmap_reset(used_slots, slot);
+  lock_release(&swap_lock);
+}
+
+/* Prints swap statistics. */
+void swap_print_stats(void) {
+  printf("Swap: %lld pages written in %lld requests, %lld pages read in %lld requests\n", out_cnt,
+         out_req_cnt, in_cnt, in_req_cnt);
+}
@@ -0,0 +1,21 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Returned by swap_out() when swap is full or absent, and stored
+   in pages that are not in swap. */
+#define SWAP_NONE SIZE_MAX
+
+/* Maximum number of pages moved by one swap request. */
+#define SWAP_CLUSTER 16
+
+void swap_init(void);
+size_t swap_out(void* const kpages[], size_t cnt);
+void swap_in(size_t slot, void* const kpages[], size_t cnt);
+void swap_free(size_t slot);
+
+void swap_print_stats(void);
+
+#endif /* vm/swap.h */